@@ -0,0 +1,383 @@
+/*
+ * hcar.c
+ *
+ * This program keeps a library of Harmony Compiler intermediate tapes in one indexed archive file (see
+ * common/hcarchive.h), so listing, searching and extracting don't decode every tape again. Parts and gaps that
+ * several tapes share are stored once.
+ * Usage: ./hcar add [-n <name>] <archive> <tape.bin>...   add tapes, replacing any of the same name
+ *        ./hcar rm <archive> <name>...                   remove tapes
+ *        ./hcar list [-l] <archive>                      list tapes, -l with their voices and parts
+ *        ./hcar find [-l] [-n <text>] [-H <hash>] [-P <hash>] [-t <tempo>] [-v <voices>] <archive>
+ *        ./hcar extract [-o <out.bin>] <archive> <name>  write a tape back out, byte for byte
+ *        ./hcar info <archive>                           sizes and how much sharing saved
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../common/hcarchive.h"
+
+#define READ_BLOCK 65536
+
+static const char *BLOB_KINDS[] = { "gap", "notes", "bars" };
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage: ./hcar add [-n <name>] <archive> <tape.bin>...   add tapes, replacing any of the same name\n"
+        "       ./hcar rm <archive> <name>...                   remove tapes\n"
+        "       ./hcar list [-l] <archive>                      list tapes, -l with their voices and parts\n"
+        "       ./hcar find [-l] [-n <text>] [-H <hash>] [-P <hash>] [-t <tempo>] [-v <voices>] <archive>\n"
+        "       ./hcar extract [-o <out.bin>] <archive> <name>  write a tape back out, byte for byte\n"
+        "       ./hcar info <archive>                           sizes and how much sharing saved\n"
+        "  find matches every filter given: -n text in the name, -H tape hash prefix, -P hash prefix of a part the\n"
+        "  tape uses, -t raw tempo the tape starts at, -v number of voices\n");
+}
+
+static uint8_t *read_file(const char *path, size_t *length) {
+    FILE *fp = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    uint8_t *data = NULL;
+    size_t capacity = 0;
+    size_t n;
+
+    *length = 0;
+    if (!fp) {
+        perror(path);
+        return NULL;
+    }
+
+    do {
+        if (*length + READ_BLOCK > capacity) {
+            capacity = capacity ? capacity * 2 : READ_BLOCK * 4;
+            uint8_t *grown = realloc(data, capacity);
+            if (!grown) {
+                fprintf(stderr, "%s: out of memory\n", path);
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+        }
+        n = fread(data + *length, 1, READ_BLOCK, fp);
+        *length += n;
+    } while (n > 0);
+
+    if (fp != stdin) fclose(fp);
+    return data;
+}
+
+// the file's name without directories or extension
+static char *tape_name(const char *path) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    const char *dot = strrchr(base, '.');
+    return strndup(base, dot && dot != base ? (size_t)(dot - base) : strlen(base));
+}
+
+// an existing archive's tapes, so it can be rewritten with changes; a missing archive is an empty one
+static int load(hc_archive_builder_t *b, const char *path) {
+    hc_archive_t ar;
+
+    if (access(path, F_OK)) return 0;
+    if (hc_archive_open(&ar, path)) {
+        fprintf(stderr, "%s: %s\n", path, ar.message);
+        hc_archive_close(&ar);
+        return -1;
+    }
+    for (uint32_t i = 0; i < ar.header->tapes_count; i++) {
+        if (hc_archive_import(b, &ar, i)) {
+            fprintf(stderr, "%s: %s\n", path, b->message);
+            hc_archive_close(&ar);
+            return -1;
+        }
+    }
+    hc_archive_close(&ar);
+    return 0;
+}
+
+static int cmd_add(int argc, char *argv[]) {
+    hc_archive_builder_t b;
+    const char *name = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+            case 'n': name = optarg; break;
+            default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind < 2 || (name && argc - optind > 2)) {
+        if (name) fprintf(stderr, "-n names a single tape\n");
+        usage();
+        return 1;
+    }
+
+    const char *path = argv[optind];
+    hc_archive_builder_init(&b);
+    if (load(&b, path)) return 1;
+
+    for (int i = optind + 1; i < argc; i++) {
+        size_t length;
+        uint64_t before = b.data_size;
+        uint8_t *tape = read_file(argv[i], &length);
+        char *tape_name_ = name ? strdup(name) : tape_name(argv[i]);
+        if (!tape || !tape_name_) return 1;
+
+        if (hc_archive_add(&b, tape_name_, tape, length)) {
+            fprintf(stderr, "%s: %s\n", argv[i], b.message);
+            return 1;
+        }
+        fprintf(stderr, "added %s: %zu bytes, %llu new\n", tape_name_, length, (unsigned long long)(b.data_size - before));
+        free(tape);
+        free(tape_name_);
+    }
+
+    if (hc_archive_write(&b, path)) {
+        fprintf(stderr, "%s\n", b.message);
+        return 1;
+    }
+    hc_archive_builder_free(&b);
+    return 0;
+}
+
+static int cmd_rm(int argc, char *argv[]) {
+    hc_archive_builder_t b;
+    int status = 0;
+
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+
+    hc_archive_builder_init(&b);
+    if (load(&b, argv[1])) return 1;
+
+    for (int i = 2; i < argc; i++) {
+        uint32_t e;
+        for (e = 0; e < b.entries_count && strcmp(b.entries[e].name, argv[i]); e++);
+        if (e == b.entries_count) {
+            fprintf(stderr, "%s: no tape named %s\n", argv[1], argv[i]);
+            status = 1;
+            continue;
+        }
+        hc_archive_remove(&b, e);
+    }
+
+    // parts no tape uses any more are left out of the rewritten archive
+    if (hc_archive_write(&b, argv[1])) {
+        fprintf(stderr, "%s\n", b.message);
+        return 1;
+    }
+    hc_archive_builder_free(&b);
+    return status;
+}
+
+static void print_duration(uint64_t us) {
+    uint64_t seconds = (us + 500000) / 1000000;
+    printf("%3llu:%02llu", (unsigned long long)(seconds / 60), (unsigned long long)(seconds % 60));
+}
+
+static void print_tape(const hc_archive_t *ar, uint32_t i, int long_format) {
+    const hc_archive_tape_t *t = &ar->tapes[i];
+
+    printf("%-24.*s %2u voice%s %9llu bytes ", (int)t->name_length, ar->names + t->name_offset, t->voices_count,
+        t->voices_count == 1 ? " " : "s", (unsigned long long)t->bytes);
+    print_duration(t->duration_us);
+    printf(" %4u BPM [raw: %5u]  %016llx\n", t->tempo ? hc_decode_tempo_quarter(t->tempo) : 0, t->tempo,
+        (unsigned long long)t->hash);
+    if (!long_format) return;
+
+    for (uint32_t v = 0; v < t->voices_count; v++) {
+        const hc_archive_voice_t *av = &ar->voices[t->first_voice + v];
+        printf("    voice %u: ", v + 1);
+        print_duration(av->duration_us);
+        printf(", tempo %u [raw: %u]", av->tempo ? hc_decode_tempo_quarter(av->tempo) : 0, av->tempo);
+        if (av->tempo_changes) printf(" + %u change%s", av->tempo_changes, av->tempo_changes == 1 ? "" : "s");
+        printf("\n");
+        printf("        notes at %8llu: %5u words, checksum %06o, %016llx\n", (unsigned long long)av->notes_offset,
+            av->notes_words, av->notes_checksum, (unsigned long long)ar->blobs[av->notes_blob].hash);
+        printf("        bars  at %8llu: %5u words, checksum %06o, %016llx\n", (unsigned long long)av->bars_offset,
+            av->bars_words, av->bars_checksum, (unsigned long long)ar->blobs[av->bars_blob].hash);
+    }
+}
+
+static int open_archive(hc_archive_t *ar, const char *path) {
+    if (hc_archive_open(ar, path)) {
+        fprintf(stderr, "%s\n", ar->message);
+        hc_archive_close(ar);
+        return -1;
+    }
+    return 0;
+}
+
+static int hash_matches(uint64_t hash, const char *prefix) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return !strncasecmp(hex, prefix, strlen(prefix));
+}
+
+static int cmd_find(int argc, char *argv[], int list) {
+    hc_archive_t ar;
+    const char *text = NULL;
+    const char *hash = NULL;
+    const char *part = NULL;
+    long tempo = -1;
+    long voices = -1;
+    int long_format = 0;
+    int found = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, list ? "lh" : "ln:H:P:t:v:h")) != -1) {
+        switch (opt) {
+            case 'l': long_format = 1; break;
+            case 'n': text = optarg; break;
+            case 'H': hash = optarg; break;
+            case 'P': part = optarg; break;
+            case 't': tempo = atol(optarg); break;
+            case 'v': voices = atol(optarg); break;
+            default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 1) {
+        usage();
+        return 1;
+    }
+    if (open_archive(&ar, argv[optind])) return 1;
+
+    for (uint32_t i = 0; i < ar.header->tapes_count; i++) {
+        const hc_archive_tape_t *t = &ar.tapes[i];
+        if (text && !memmem(ar.names + t->name_offset, t->name_length, text, strlen(text))) continue;
+        if (hash && !hash_matches(t->hash, hash)) continue;
+        if (tempo >= 0 && t->tempo != tempo) continue;
+        if (voices >= 0 && t->voices_count != voices) continue;
+        if (part) {
+            uint32_t s;
+            for (s = 0; s < t->segments_count; s++) {
+                const hc_archive_blob_t *blob = &ar.blobs[ar.segments[t->first_segment + s]];
+                if (blob->kind != HC_BLOB_GAP && hash_matches(blob->hash, part)) break;
+            }
+            if (s == t->segments_count) continue;
+        }
+        print_tape(&ar, i, long_format);
+        found++;
+    }
+
+    hc_archive_close(&ar);
+    return list || found ? 0 : 1;
+}
+
+static int cmd_extract(int argc, char *argv[]) {
+    hc_archive_t ar;
+    const char *out_path = "-";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:h")) != -1) {
+        switch (opt) {
+            case 'o': out_path = optarg; break;
+            default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 2) {
+        usage();
+        return 1;
+    }
+    if (open_archive(&ar, argv[optind])) return 1;
+
+    long tape = hc_archive_find(&ar, argv[optind + 1]);
+    if (tape < 0) {
+        fprintf(stderr, "%s: no tape named %s\n", argv[optind], argv[optind + 1]);
+        hc_archive_close(&ar);
+        return 1;
+    }
+
+    FILE *out = strcmp(out_path, "-") ? fopen(out_path, "wb") : stdout;
+    if (!out) {
+        perror(out_path);
+        hc_archive_close(&ar);
+        return 1;
+    }
+    int failed = hc_archive_extract(&ar, tape, out) || ferror(out);
+    if (out != stdout && fclose(out)) failed = 1;
+    if (failed) perror(out_path);
+
+    hc_archive_close(&ar);
+    return failed;
+}
+
+static int cmd_info(int argc, char *argv[]) {
+    hc_archive_t ar;
+    uint64_t tapes_bytes = 0;
+    uint64_t kinds[3] = {0};
+    uint32_t kinds_count[3] = {0};
+
+    if (argc != 2) {
+        usage();
+        return 1;
+    }
+    if (open_archive(&ar, argv[1])) return 1;
+
+    for (uint32_t i = 0; i < ar.header->tapes_count; i++) tapes_bytes += ar.tapes[i].bytes;
+    for (uint32_t i = 0; i < ar.header->blobs_count; i++) {
+        uint32_t kind = ar.blobs[i].kind < 3 ? ar.blobs[i].kind : HC_BLOB_GAP;
+        kinds[kind] += ar.blobs[i].length;
+        kinds_count[kind]++;
+    }
+
+    printf("%u tapes, %u voices, %zu bytes (index %llu, data %llu)\n", ar.header->tapes_count, ar.header->voices_count,
+        ar.size, (unsigned long long)ar.header->data_offset, (unsigned long long)ar.header->data_size);
+    for (int k = 0; k < 3; k++) {
+        printf("  %-5s %6u stored, %10llu bytes\n", BLOB_KINDS[k], kinds_count[k], (unsigned long long)kinds[k]);
+    }
+    printf("tapes hold %llu bytes, %u segments; stored once that's %llu (%.1f%% saved)\n",
+        (unsigned long long)tapes_bytes, ar.header->segments_count, (unsigned long long)ar.header->data_size,
+        tapes_bytes ? 100.0 * (tapes_bytes - ar.header->data_size) / tapes_bytes : 0.0);
+
+    hc_archive_close(&ar);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    // each command parses its own options, with the command as its argv[0]
+    const char *cmd = argv[1];
+    argc--;
+    argv++;
+    if (!strcmp(cmd, "add")) return cmd_add(argc, argv);
+    if (!strcmp(cmd, "rm")) return cmd_rm(argc, argv);
+    if (!strcmp(cmd, "list")) return cmd_find(argc, argv, 1);
+    if (!strcmp(cmd, "find")) return cmd_find(argc, argv, 0);
+    if (!strcmp(cmd, "extract")) return cmd_extract(argc, argv);
+    if (!strcmp(cmd, "info")) return cmd_info(argc, argv);
+
+    usage();
+    return !(strcmp(cmd, "-h") == 0 || strcmp(cmd, "help") == 0);
+}
@@ -0,0 +1,316 @@
+#!/usr/bin/env python3
+"""
+e2e.py - end-to-end benchmark of the tape pipeline, stage by stage.
+
+Runs the stages of util/pipeline.py in a scratch copy of the repo, each in its
+own forked process, and records per stage wall time, CPU time (user + system,
+children included), the peak RSS of the tools it runs (through
+bench/peakrss, since anything the driver forks keeps the interpreter's
+high-water mark), bytes read and written (the sizes of the stage's data
+inputs and outputs) and block I/O from getrusage.  A stage that runs no tool,
+only Python in the driver, gets the driver's peak RSS as driver_rss_kb
+instead, which is mostly the interpreter and isn't compared.  Every workload is run --repeat times and
+summarized (mean, median, min, max, stdev), and the results are written as
+JSON.
+
+Workloads
+---------
+    olson        the whole pipeline from voices/*.txt, with an empty compile cache
+    olson-warm   the same with the compile cache filled, so compiles are cache hits
+    gen-8k       a bench/gentape tape (4 voices, 64 measures) through verify, tweak, overlay, SVG and WAV
+    gen-64k      the same with 800 measures
+    gen-SIZE     --gen SIZE adds a gentape -S SIZE tape; stages that can't read it are reported as failed
+
+With a baseline (bench/baseline.json unless --baseline says otherwise), each
+stage's median wall and CPU times and peak RSS are compared against it, and
+the exit status is 1 if any got worse by more than --threshold percent (and
+by more than 5 ms, below which timings are noise).  --write-baseline saves
+this run as the baseline.  Baselines only compare on the same machine.
+
+Usage
+-----
+    python3 bench/e2e.py [--repeat N] [--workload NAME ...] [--gen SIZE ...] [-o results.json]
+                         [--baseline FILE] [--write-baseline] [--threshold PCT]
+
+Run ./build.sh first to build the tools.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+from datetime import datetime, timezone
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(ROOT / "util"))
+
+import hccompile  # noqa: E402
+import pipeline  # noqa: E402
+
+DEFAULT_BASELINE = ROOT / "bench/baseline.json"
+SKIP = {".git", ".hccache", ".pipeline-state.json", "catalog", "__pycache__"}
+TAPE_STAGES = ["verify", "tweak", "leader", "trailer", "replace", "svg", "wav"]
+COMPARED = ["wall_s", "cpu_s", "max_rss_kb"]
+NOISE = {"wall_s": 0.005, "cpu_s": 0.005, "max_rss_kb": 1024}
+
+
+def workspace(into: Path) -> Path:
+    """Copy the repo, built tools included, so runs never touch the working tree."""
+    ws = into / "repo"
+    shutil.copytree(ROOT, ws, symlinks=True, ignore=lambda _dir, names: [n for n in names if n in SKIP])
+    return ws
+
+
+def point_at(ws: Path, cache: Path) -> None:
+    """Aim the pipeline and compile cache at a workspace."""
+    pipeline.ROOT = ws
+    hccompile.ROOT = ws
+    hccompile.HC_DIR = ws / "hc_binmaker"
+    hccompile.CACHE_DIR = cache
+
+
+def is_tool(ws: Path, path: str) -> bool:
+    return path.endswith(".py") or os.access(ws / path, os.X_OK)
+
+
+def size(ws: Path, path: str) -> int:
+    try:
+        return (ws / path).stat().st_size
+    except FileNotFoundError:
+        return 0
+
+
+def measure(stage: pipeline.Stage, ws: Path) -> dict:
+    """Run a stage in a forked child and return its metrics."""
+    sys.stdout.flush()
+    sys.stderr.flush()
+    errors = tempfile.TemporaryFile()
+    peaks = tempfile.NamedTemporaryFile()
+    start = time.perf_counter()
+    pid = os.fork()
+    if pid == 0:
+        status = 0
+        try:
+            # the pipeline's own progress lines would only clutter the report, errors are kept for it
+            os.dup2(os.open(os.devnull, os.O_WRONLY), 1)
+            os.dup2(errors.fileno(), 2)
+            # every tool the stage runs goes through peakrss, which records the tool's own peak RSS
+            popen = subprocess.Popen
+            subprocess.Popen = lambda args, *rest, **kwargs: popen(
+                [str(ws / "bench/peakrss"), peaks.name, *args], *rest, **kwargs)
+            stage.run()
+        except BaseException as exc:
+            print(exc, file=sys.stderr)
+            status = 1
+        finally:
+            sys.stderr.flush()
+            os._exit(status)
+
+    _, status, usage = os.wait4(pid, 0)
+    wall = time.perf_counter() - start
+    if os.waitstatus_to_exitcode(status) != 0:
+        errors.seek(0)
+        lines = [line for line in errors.read().decode(errors="replace").splitlines() if line.strip()]
+        raise RuntimeError(" ".join(line.strip() for line in lines[-2:]) or f"exit status {os.waitstatus_to_exitcode(status)}")
+    tools_rss = max((int(line) for line in peaks.read().split()), default=0)
+
+    return {
+        "wall_s": wall,
+        "cpu_s": usage.ru_utime + usage.ru_stime,
+        # the largest tool the stage ran, 0 for a stage that ran only Python inside the driver, whose footprint
+        # (mostly the interpreter's) is driver_rss_kb instead
+        "max_rss_kb": tools_rss,
+        "driver_rss_kb": usage.ru_maxrss if not tools_rss else 0,
+        "read_bytes": sum(size(ws, path) for path in stage.inputs if not is_tool(ws, path)),
+        "write_bytes": sum(size(ws, path) for path in stage.outputs),
+        "in_blocks": usage.ru_inblock,
+        "out_blocks": usage.ru_oublock,
+    }
+
+
+def order(all_stages: list[pipeline.Stage], names: list[str] | None) -> list[pipeline.Stage]:
+    """Stages in dependency order, limited to names when given."""
+    by_name = {stage.name: stage for stage in all_stages}
+    wanted = set(names) if names else set(by_name)
+    done: list[str] = []
+    while len(done) < len(wanted):
+        for name in sorted(wanted - set(done)):
+            if all(dep in done or dep not in wanted for dep in by_name[name].deps):
+                done.append(name)
+    return [by_name[name] for name in done]
+
+
+def gentape(ws: Path, args: list[str]) -> None:
+    """Put a generated tape where the compile stage leaves the real one."""
+    subprocess.run([str(ws / "bench/gentape"), *args, "-o", str(ws / "hc_binmaker/boc-olson.bin")],
+                   check=True, stderr=subprocess.DEVNULL)
+
+
+def run_workload(name: str, repeat: int, scratch: Path) -> dict:
+    runs: dict[str, list[dict]] = {}
+    failures: dict[str, str] = {}
+
+    for i in range(repeat):
+        ws = workspace(scratch / f"{name}-{i}")
+        cache = scratch / f"{name}-{i}-cache"
+        point_at(ws, cache)
+        all_stages = pipeline.stages("bmp")
+
+        if name.startswith("olson"):
+            stages = order(all_stages, None)
+            if name == "olson-warm":
+                for stage in stages:
+                    if stage.name.startswith("voice-"):
+                        stage.run()
+        else:
+            gen_args = {"gen-8k": [], "gen-64k": ["-m", "800"]}.get(name, ["-S", name[len("gen-"):], "-m", "200"])
+            gentape(ws, gen_args)
+            stages = order(all_stages, TAPE_STAGES)
+
+        failed: set[str] = set()
+        for stage in stages:
+            if stage.deps & failed:
+                failed.add(stage.name)
+                continue
+            try:
+                sample = measure(stage, ws)
+                runs.setdefault(stage.name, []).append(sample)
+            except RuntimeError as exc:
+                failed.add(stage.name)
+                failures[stage.name] = str(exc)
+        shutil.rmtree(scratch / f"{name}-{i}", ignore_errors=True)
+        shutil.rmtree(cache, ignore_errors=True)
+
+    result = {"stages": {stage: summarize(samples) for stage, samples in runs.items()}}
+    totals = [{metric: sum(runs[stage][i][metric] for stage in runs if i < len(runs[stage]))
+               for metric in ("wall_s", "cpu_s")} for i in range(repeat)]
+    result["total"] = summarize(totals)
+    if failures:
+        result["failed"] = failures
+    return result
+
+
+def summarize(samples: list[dict]) -> dict:
+    summary = {}
+    for metric in samples[0]:
+        values = [sample[metric] for sample in samples]
+        summary[metric] = {
+            "n": len(values),
+            "mean": statistics.fmean(values),
+            "median": statistics.median(values),
+            "min": min(values),
+            "max": max(values),
+            "stdev": statistics.stdev(values) if len(values) > 1 else 0.0,
+        }
+    return summary
+
+
+def report(results: dict) -> None:
+    for name, workload in results["workloads"].items():
+        print(f"\n{name}")
+        print(f"  {'stage':<14} {'wall ms':>9} {'cpu ms':>9} {'rss MB':>8} {'read KB':>9} {'write KB':>9}")
+        for stage, summary in workload["stages"].items():
+            # a stage run in the driver is marked, its RSS is mostly the Python interpreter's
+            in_driver = not summary["max_rss_kb"]["median"]
+            rss = summary["driver_rss_kb" if in_driver else "max_rss_kb"]["median"] / 1024
+            print(f"  {stage:<14} {summary['wall_s']['median'] * 1000:>9.1f} {summary['cpu_s']['median'] * 1000:>9.1f}"
+                  f" {rss:>7.1f}{'*' if in_driver else ' '} {summary['read_bytes']['median'] / 1024:>9.1f}"
+                  f" {summary['write_bytes']['median'] / 1024:>9.1f}")
+        total = workload["total"]
+        print(f"  {'total':<14} {total['wall_s']['median'] * 1000:>9.1f} {total['cpu_s']['median'] * 1000:>9.1f}")
+        if any(not summary["max_rss_kb"]["median"] for summary in workload["stages"].values()):
+            print("  * run in the Python driver, not compared against the baseline")
+        for stage, error in workload.get("failed", {}).items():
+            print(f"  {stage}: FAILED ({error})")
+
+
+def compare(results: dict, baseline: dict, threshold: float) -> int:
+    """Print changes against the baseline, return the number of regressions."""
+    regressions = 0
+    print(f"\nagainst baseline from {baseline['meta']['date']}:")
+    for name, workload in results["workloads"].items():
+        base_workload = baseline["workloads"].get(name)
+        if not base_workload:
+            continue
+        for stage, summary in workload["stages"].items():
+            base = base_workload["stages"].get(stage)
+            if not base:
+                continue
+            for metric in COMPARED:
+                now, then = summary[metric]["median"], base[metric]["median"]
+                change = (now - then) / then * 100 if then else 0.0
+                worse = change > threshold and now - then > NOISE[metric]
+                if worse or abs(change) > threshold:
+                    print(f"  {name} {stage} {metric}: {then:.4g} -> {now:.4g} ({change:+.0f}%)"
+                          + ("  REGRESSION" if worse else ""))
+                regressions += worse
+    if not regressions:
+        print("  no regressions")
+    return regressions
+
+
+def git_revision() -> str:
+    proc = subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=ROOT, capture_output=True, text=True)
+    return proc.stdout.strip() or "unknown"
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Benchmark the tape pipeline stage by stage.")
+    parser.add_argument("--repeat", "-r", type=int, default=5, help="runs per workload (default: 5)")
+    parser.add_argument("--workload", "-w", action="append",
+                        choices=["olson", "olson-warm", "gen-8k", "gen-64k"], help="workloads to run (default: all)")
+    parser.add_argument("--gen", action="append", default=[], metavar="SIZE", help="add a gentape -S SIZE workload")
+    parser.add_argument("--output", "-o", type=Path, help="write the results JSON here")
+    parser.add_argument("--baseline", type=Path, default=DEFAULT_BASELINE, help="baseline JSON to compare against")
+    parser.add_argument("--write-baseline", action="store_true", help="save these results as the baseline")
+    parser.add_argument("--threshold", type=float, default=10.0, help="percent worse that counts as a regression")
+    args = parser.parse_args()
+
+    missing = [tool for tool in ("hc_binmaker/pdp1", "hc_binmaker/ascii2fiodec", "hc_binmaker/splice", "tweak/tweak",
+                                 "verify/decodehcint", "render/render", "bench/gentape", "bench/peakrss") if not (ROOT / tool).exists()]
+    if missing:
+        sys.exit(f"missing {', '.join(missing)}, run ./build.sh first")
+
+    names = (args.workload or ["olson", "olson-warm", "gen-8k", "gen-64k"]) + [f"gen-{size}" for size in args.gen]
+    results = {
+        "meta": {
+            "date": datetime.now(timezone.utc).isoformat(timespec="seconds"),
+            "revision": git_revision(),
+            "host": platform.node(),
+            "platform": platform.platform(),
+            "cpus": os.cpu_count(),
+            "python": platform.python_version(),
+            "repeat": args.repeat,
+        },
+        "workloads": {},
+    }
+
+    with tempfile.TemporaryDirectory(prefix="e2e-") as scratch:
+        for name in names:
+            print(f"running {name} x{args.repeat}", file=sys.stderr)
+            results["workloads"][name] = run_workload(name, max(1, args.repeat), Path(scratch))
+
+    report(results)
+    if args.output:
+        args.output.write_text(json.dumps(results, indent=2) + "\n")
+
+    regressions = 0
+    if args.baseline.exists() and not args.write_baseline:
+        regressions = compare(results, json.loads(args.baseline.read_text()), args.threshold)
+    if args.write_baseline:
+        args.baseline.write_text(json.dumps(results, indent=2) + "\n")
+        print(f"\nbaseline written to {args.baseline}")
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
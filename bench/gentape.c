@@ -0,0 +1,310 @@
+/*
+ * gentape.c
+ *
+ * This program generates synthetic Harmony Compiler intermediate tapes, for benchmarking and fuzzing the tools on
+ * inputs from kilobytes to gigabytes. Tapes are valid by default: every voice has a notes part of 4/4 measures
+ * (tempo words, notes, end-of-measure words) and a bars part indexing into it, with correct checksums and the
+ * compiler's leader and gaps. Faults can be injected on request. The output is reproducible from the seed.
+ * Usage: ./gentape [options] (see -h)
+ *
+ * Note that verify/decodehcint only reads the first 4 voices unless given -a.
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../common/hctape.h"
+
+#define MAX_NOTES_WORDS 0577777     // bar indexes must stay below the end-of-measure word
+#define WHOLE_DURATION 64           // duration field of a whole note, 3 ticks per unit
+
+enum {
+    FAULT_INNER = 1,                // blank frame inside a word
+    FAULT_CHECKSUM = 2,             // wrong checksum on a part
+    FAULT_INDEX = 4,                // bar index past the end of the notes part
+    FAULT_TRUNCATE = 8,             // tape ends inside the voice's bars part
+};
+
+typedef struct {
+    uint32_t voices;
+    uint32_t measures;
+    uint32_t density;               // notes per measure, on average
+    uint32_t reuse;                 // percent of bars that repeat an earlier measure, like the compiler's copy
+    uint32_t tempo_changes;         // percent of measures that start with a tempo word
+    uint32_t triplets;              // percent of splittable notes played as triplets
+    uint32_t rests;                 // percent of notes that are rests
+    uint32_t tempo;
+    uint64_t size;                  // keep adding voices until the tape is at least this many bytes
+    uint32_t leader;
+    uint32_t inner_gap;
+    uint32_t trailer;
+    int gap_frame;                  // frame punched in gaps, anything without the 8th bit is blank to rpb
+    uint32_t faults;
+    uint32_t fault_voice;
+    uint64_t seed;
+    const char *out_path;
+} options_t;
+
+static uint64_t rng_state;
+
+static uint32_t rng(void) {
+    // xorshift64*, plenty for test data and the same on every platform
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static int chance(uint32_t percent) {
+    return rng() % 100 < percent;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage: ./gentape [options]\n"
+        "  -o FILE  output tape (default: '-' for stdout)\n"
+        "  -v N     voices (default: 4)\n"
+        "  -m N     measures per voice (default: 64)\n"
+        "  -d N     notes per measure, on average (default: 8)\n"
+        "  -r PCT   bars that repeat an earlier measure (default: 25)\n"
+        "  -p PCT   measures starting with a tempo change (default: 0)\n"
+        "  -3 PCT   notes split into triplets (default: 5)\n"
+        "  -R PCT   rests (default: 10)\n"
+        "  -t N     raw tempo (default: 99)\n"
+        "  -S SIZE  add voices until the tape is at least SIZE bytes, with k/M/G suffixes (overrides -v)\n"
+        "  -L N     leader frames per voice (default: %d)\n"
+        "  -g N     frames between notes and bars parts (default: %d)\n"
+        "  -T N     trailer frames per voice (default: %d)\n"
+        "  -z       punch gaps with 0177 frames instead of nulls\n"
+        "  -x KIND  inject a fault: inner, checksum, index or truncate (repeatable)\n"
+        "  -X N     voice to inject faults into (default: 1)\n"
+        "  -s N     random seed (default: 1)\n",
+        HC_LEADER_FRAMES, HC_INNER_GAP_FRAMES, HC_TRAILER_FRAMES);
+}
+
+static uint64_t parse_size(const char *s) {
+    char *end;
+    uint64_t size = strtoull(s, &end, 10);
+
+    switch (*end) {
+        case 'k': case 'K': return size << 10;
+        case 'm': case 'M': return size << 20;
+        case 'g': case 'G': return size << 30;
+        default: return size;
+    }
+}
+
+// appends one measure's notes, splitting a whole note at random until it has about density notes
+static uint32_t gen_measure(uint32_t *words, const options_t *opts) {
+    static const uint32_t ARTICULATIONS[] = { 0, 0, 0, 0, 0, 1, 2, 4, 8, 8 };
+    uint32_t durations[WHOLE_DURATION];
+    uint32_t count = 1;
+    uint32_t n = 0;
+
+    durations[0] = WHOLE_DURATION;
+    for (uint32_t tries = 0; count < opts->density && tries < 4 * WHOLE_DURATION; tries++) {
+        uint32_t i = rng() % count;
+        if (durations[i] < 2) continue;
+        memmove(&durations[i + 1], &durations[i], (count - i) * sizeof(uint32_t));
+        durations[i] /= 2;
+        durations[i + 1] = durations[i];
+        count++;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t articulation = ARTICULATIONS[rng() % 10];
+        uint32_t pitch = chance(opts->rests) ? 0 : 2 + rng() % 62;
+        if (durations[i] >= 2 && chance(opts->triplets)) {
+            // three triplet notes of half the duration, at 2 ticks per unit, fill the same 3 * duration ticks
+            for (int t = 0; t < 3; t++) words[n++] = HC_NOTE_WORD(articulation, 1, pitch, durations[i] / 2);
+        } else {
+            words[n++] = HC_NOTE_WORD(articulation, 0, pitch, durations[i]);
+        }
+    }
+
+    words[n++] = HC_END_OF_MEASURE;
+    return n;
+}
+
+static void gap(FILE *fp, uint32_t frames, int frame) {
+    while (frames--) putc(frame, fp);
+}
+
+// punches a part, with a corrupted checksum or a blank frame inside a word on request
+static void punch_part(FILE *fp, const uint32_t *words, uint32_t count, uint32_t faults) {
+    uint32_t checksum = 0;
+    uint32_t inner_at = (faults & FAULT_INNER) && count ? rng() % count : UINT32_MAX;
+
+    hc_ppb(fp, count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (i == inner_at) {
+            putc(0200 | ((words[i] & 0770000) >> 12), fp);
+            putc(0, fp);
+            putc(0200 | ((words[i] & 0007700) >> 6), fp);
+            putc(0200 | (words[i] & 0000077), fp);
+        } else {
+            hc_ppb(fp, words[i]);
+        }
+        checksum = hc_add_1s_complement(checksum, words[i]);
+    }
+    hc_ppb(fp, faults & FAULT_CHECKSUM ? checksum ^ 1 : checksum);
+}
+
+int main(int argc, char *argv[]) {
+    options_t opts = {
+        .voices = 4, .measures = 64, .density = 8, .reuse = 25, .tempo_changes = 0, .triplets = 5, .rests = 10,
+        .tempo = HC_DEFAULT_TEMPO, .size = 0, .leader = HC_LEADER_FRAMES, .inner_gap = HC_INNER_GAP_FRAMES,
+        .trailer = HC_TRAILER_FRAMES, .gap_frame = 0, .faults = 0, .fault_voice = 1, .seed = 1, .out_path = "-",
+    };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:v:m:d:r:p:3:R:t:S:L:g:T:zx:X:s:h")) != -1) {
+        switch (opt) {
+            case 'o': opts.out_path = optarg; break;
+            case 'v': opts.voices = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'm': opts.measures = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'd': opts.density = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'r': opts.reuse = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'p': opts.tempo_changes = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case '3': opts.triplets = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'R': opts.rests = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 't': opts.tempo = (uint32_t)strtoul(optarg, NULL, 0) & 0077777; break;
+            case 'S': opts.size = parse_size(optarg); break;
+            case 'L': opts.leader = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'g': opts.inner_gap = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'T': opts.trailer = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'z': opts.gap_frame = 0177; break;
+            case 'x':
+                if (!strcmp(optarg, "inner")) opts.faults |= FAULT_INNER;
+                else if (!strcmp(optarg, "checksum")) opts.faults |= FAULT_CHECKSUM;
+                else if (!strcmp(optarg, "index")) opts.faults |= FAULT_INDEX;
+                else if (!strcmp(optarg, "truncate")) opts.faults |= FAULT_TRUNCATE;
+                else {
+                    fprintf(stderr, "unknown fault: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'X': opts.fault_voice = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 's': opts.seed = strtoull(optarg, NULL, 0); break;
+            default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind != argc || !opts.measures || !opts.density || opts.density > WHOLE_DURATION || !opts.inner_gap) {
+        usage();
+        return 1;
+    }
+
+    // a measure is at most density notes tripled, plus its end-of-measure and tempo words
+    uint64_t max_words = 1 + (uint64_t)opts.measures * (3 * opts.density + 2);
+    if (max_words > MAX_NOTES_WORDS) {
+        fprintf(stderr, "too many measures for one notes part, bar indexes only reach %o\n", MAX_NOTES_WORDS);
+        return 1;
+    }
+
+    uint32_t *notes = malloc(max_words * sizeof(uint32_t));
+    uint32_t *starts = malloc(opts.measures * sizeof(uint32_t));
+    uint32_t *bars = malloc((opts.measures + 1) * sizeof(uint32_t));
+    if (!notes || !starts || !bars) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    FILE *fp = strcmp(opts.out_path, "-") ? fopen(opts.out_path, "wb") : stdout;
+    if (!fp) {
+        perror(opts.out_path);
+        return 1;
+    }
+
+    rng_state = opts.seed ? opts.seed : 1;
+    uint64_t bytes = 0;
+    uint32_t voice;
+
+    for (voice = 1; opts.size ? bytes < opts.size : voice <= opts.voices; voice++) {
+        uint32_t faults = voice == opts.fault_voice ? opts.faults : 0;
+        uint32_t count = 0;
+        uint32_t unique = 0;
+
+        // the first voice carries the tempo, as the compiler punches it for the voice that sets it
+        if (voice == 1) notes[count++] = HC_TEMPO_MASK | opts.tempo;
+
+        for (uint32_t m = 0; m < opts.measures; m++) {
+            if (unique && chance(opts.reuse)) {
+                bars[m] = starts[rng() % unique];
+                continue;
+            }
+            starts[unique++] = count;
+            bars[m] = count;
+            if (chance(opts.tempo_changes)) notes[count++] = HC_TEMPO_MASK | (1 + opts.tempo / 2 + rng() % (opts.tempo + 1));
+            count += gen_measure(&notes[count], &opts);
+        }
+        bars[opts.measures] = HC_END_OF_MEASURE;
+
+        if (faults & FAULT_INDEX) {
+            uint32_t m = rng() % opts.measures;
+            bars[m] = count + rng() % 64;
+            fprintf(stderr, "voice %u: bar %u indexes %u of %u notes words\n", voice, m + 1, bars[m], count);
+        }
+
+        gap(fp, opts.leader, opts.gap_frame);
+        punch_part(fp, notes, count, faults & ~FAULT_CHECKSUM);
+        gap(fp, opts.inner_gap, opts.gap_frame);
+
+        if (faults & FAULT_TRUNCATE) {
+            // stop partway through the bars part
+            uint32_t keep = rng() % (opts.measures + 1);
+            hc_ppb(fp, opts.measures + 1);
+            for (uint32_t i = 0; i < keep; i++) hc_ppb(fp, bars[i]);
+            fprintf(stderr, "voice %u: truncated after %u of %u bars words\n", voice, keep, opts.measures + 1);
+            voice++;
+            break;
+        }
+
+        punch_part(fp, bars, opts.measures + 1, faults & ~FAULT_INNER);
+        gap(fp, opts.trailer, opts.gap_frame);
+        if (faults & (FAULT_INNER | FAULT_CHECKSUM)) {
+            fprintf(stderr, "voice %u:%s%s\n", voice,
+                faults & FAULT_INNER ? " inner blank frame in notes part" : "",
+                faults & FAULT_CHECKSUM ? " bad bars checksum" : "");
+        }
+
+        // counted rather than asked of ftello(), which can't answer for a pipe
+        bytes += opts.leader + 3 * (count + 2) + opts.inner_gap + 3 * (opts.measures + 3) + opts.trailer;
+        if (faults & FAULT_INNER) bytes++;
+    }
+
+    if (ferror(fp) || (fp != stdout && fclose(fp))) {
+        perror(opts.out_path);
+        return 1;
+    }
+
+    fprintf(stderr, "%u voices\n", voice - 1);
+    free(notes);
+    free(starts);
+    free(bars);
+    return 0;
+}
@@ -0,0 +1,633 @@
+/*
+ * microbench.c
+ *
+ * This program times the primitives the tape tools share, so changes to them can be judged by numbers: rpb frame
+ * assembly, ppb frame punching, the 1s complement checksum, note field extraction, tempo decoding, and FIODEC parity
+ * and encoding. Each kernel has its scalar form as the tools use it, and any faster variants, which must produce the
+ * same result. Every variant gets warmup runs, then the fastest of the timed runs is reported in ns and TSC cycles per
+ * input byte (cycles at the TSC's fixed rate, which can differ from the core clock).
+ * Usage: ./microbench [-s <sizes>] [-r <runs>] [-w <warmups>] [-k <kernel>]
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/hctape.h"
+#include "../common/hcfiodec.h"
+
+#ifdef HC_FIODEC_SIMD
+#define SIMD
+#include <x86intrin.h>
+#endif
+
+#define DEFAULT_SIZES "4k,64k,1M,16M"
+#define DEFAULT_RUNS 10
+#define DEFAULT_WARMUPS 2
+#define GAP_EVERY 50                // words between blank gaps in the test tape, about a part's length
+#define FIODEC_BLOCK 65536          // ascii2fiodec's read and write block
+
+typedef struct {
+    const char *kernel;
+    const char *variant;
+    uint64_t (*run)(void);          // returns a digest every variant of the kernel must agree on
+    int (*supported)(void);
+} bench_t;
+
+// inputs, rebuilt for every size
+static uint8_t *tape;               // punched words with gaps
+static size_t tape_len;
+static uint32_t *words;             // random 18-bit words
+static uint32_t *note_words;        // valid note words
+static uint32_t *tempo_words;
+static size_t words_len;
+static uint8_t *text;               // ASCII source text
+static uint8_t *codes;              // 6-bit FIODEC codes
+static size_t text_len;
+
+// outputs, so the compiler can't drop the work
+static uint32_t *out_words;
+static uint8_t *out_bytes;
+static uint8_t *out_fields[4];
+static uint16_t tempo_table[0100000];
+static uint8_t parity_table[0100];
+static uint8_t fiodec_out[2 * FIODEC_BLOCK];
+static FILE *devnull;
+
+static uint64_t sum_words(const uint32_t *w, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += w[i];
+    return sum + ((uint64_t)n << 40);
+}
+
+// 8 bytes at a time, so checking the result costs little next to the kernel that made it
+static uint64_t sum_bytes(const uint8_t *b, size_t n) {
+    uint64_t sum = n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t chunk;
+        memcpy(&chunk, b + i, 8);
+        sum += chunk;
+    }
+    for (; i < n; i++) sum += (uint64_t)b[i] << (8 * (i & 7));
+    return sum;
+}
+
+static uint64_t sum_fields(size_t n) {
+    uint64_t sum = 0;
+    for (int f = 0; f < 4; f++) sum = sum * 31 + sum_bytes(out_fields[f], n);
+    return sum;
+}
+
+/*
+ * rpb: frames to words
+ */
+static uint64_t rpb_scalar(void) {
+    hc_framer_t f = {0};
+    uint32_t word;
+    size_t n = 0;
+
+    for (size_t i = 0; i < tape_len; i++) {
+        if (hc_framer_push(&f, tape[i], &word)) {
+            out_words[n++] = word;
+            hc_framer_next(&f);
+        }
+    }
+
+    return sum_words(out_words, n);
+}
+
+#ifdef SIMD
+// 12 binary frames at a word boundary become 4 words in one shuffle, anything else goes a frame at a time
+__attribute__((target("ssse3")))
+static uint64_t rpb_ssse3(void) {
+    const __m128i order = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i low6 = _mm_set1_epi32(0x3f3f3f);
+    hc_framer_t f = {0};
+    uint32_t word;
+    size_t n = 0;
+    size_t i = 0;
+
+    while (i < tape_len) {
+        if (!f.frames && i + 16 <= tape_len) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(tape + i));
+            if ((_mm_movemask_epi8(v) & 0x0fff) == 0x0fff) {
+                // each lane holds frames 3, 2, 1 low to high, their 6 bits close up into the word
+                __m128i x = _mm_and_si128(_mm_shuffle_epi8(v, order), low6);
+                __m128i w = _mm_or_si128(_mm_and_si128(x, _mm_set1_epi32(077)),
+                    _mm_or_si128(_mm_and_si128(_mm_srli_epi32(x, 2), _mm_set1_epi32(07700)),
+                                 _mm_and_si128(_mm_srli_epi32(x, 4), _mm_set1_epi32(0770000))));
+                _mm_storeu_si128((__m128i *)(out_words + n), w);
+                n += 4;
+                i += 12;
+                continue;
+            }
+        }
+        if (hc_framer_push(&f, tape[i++], &word)) {
+            out_words[n++] = word;
+            hc_framer_next(&f);
+        }
+    }
+
+    return sum_words(out_words, n);
+}
+#endif
+
+/*
+ * ppb: words to frames
+ */
+static uint64_t ppb_stdio(void) {
+    // hc_ppb() as the tools call it, putc() to a FILE
+    for (size_t i = 0; i < words_len; i++) hc_ppb(devnull, words[i]);
+    fflush(devnull);
+
+    // the FILE can't be read back, so the digest comes from the same frames made the plain way
+    uint8_t *p = out_bytes;
+    for (size_t i = 0; i < words_len; i++) {
+        *p++ = 0200 | ((words[i] & 0770000) >> 12);
+        *p++ = 0200 | ((words[i] & 0007700) >> 6);
+        *p++ = 0200 | (words[i] & 0000077);
+    }
+    return sum_bytes(out_bytes, words_len * 3);
+}
+
+static uint64_t ppb_buffer(void) {
+    uint8_t *p = out_bytes;
+
+    for (size_t i = 0; i < words_len; i++) {
+        *p++ = 0200 | ((words[i] & 0770000) >> 12);
+        *p++ = 0200 | ((words[i] & 0007700) >> 6);
+        *p++ = 0200 | (words[i] & 0000077);
+    }
+
+    return sum_bytes(out_bytes, words_len * 3);
+}
+
+#ifdef SIMD
+__attribute__((target("ssse3")))
+static uint64_t ppb_ssse3(void) {
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i mask = _mm_set1_epi32(077);
+    const __m128i punch = _mm_set1_epi32(0x808080);
+    uint8_t *p = out_bytes;
+    size_t i = 0;
+
+    // out_bytes has room for the 4 bytes each store runs past the 12 it keeps
+    for (; i + 4 <= words_len; i += 4, p += 12) {
+        __m128i w = _mm_loadu_si128((const __m128i *)(words + i));
+        __m128i x = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(w, 12), mask),
+            _mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(w, 6), mask), 8),
+                         _mm_slli_epi32(_mm_and_si128(w, mask), 16)));
+        _mm_storeu_si128((__m128i *)p, _mm_shuffle_epi8(_mm_or_si128(x, punch), pack));
+    }
+    for (; i < words_len; i++) {
+        *p++ = 0200 | ((words[i] & 0770000) >> 12);
+        *p++ = 0200 | ((words[i] & 0007700) >> 6);
+        *p++ = 0200 | (words[i] & 0000077);
+    }
+
+    return sum_bytes(out_bytes, words_len * 3);
+}
+#endif
+
+/*
+ * 1s complement checksum
+ */
+static uint64_t checksum_scalar(void) {
+    uint32_t checksum = 0;
+    for (size_t i = 0; i < words_len; i++) checksum = hc_add_1s_complement(checksum, words[i]);
+    return checksum;
+}
+
+// end-around carries can all wait until the end, folding a wide sum gives the same 1s complement result
+static uint32_t fold(uint64_t sum) {
+    while (sum > 0777777) sum = (sum & 0777777) + (sum >> 18);
+    return (uint32_t)sum;
+}
+
+static uint64_t checksum_deferred(void) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < words_len; i++) sum += words[i];
+    return fold(sum);
+}
+
+#ifdef SIMD
+__attribute__((target("avx2")))
+static uint64_t checksum_avx2(void) {
+    __m256i acc = _mm256_setzero_si256();
+    uint64_t lanes[4];
+    uint64_t sum = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= words_len; i += 4) {
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)(words + i))));
+    }
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < words_len; i++) sum += words[i];
+
+    return fold(sum);
+}
+#endif
+
+/*
+ * note fields
+ */
+static uint64_t note_parse(void) {
+    hc_note_t note;
+
+    for (size_t i = 0; i < words_len; i++) {
+        hc_parse_note(note_words[i], &note);
+        out_fields[0][i] = note.articulation;
+        out_fields[1][i] = note.triplet;
+        out_fields[2][i] = note.pitch;
+        out_fields[3][i] = note.duration;
+    }
+
+    return sum_fields(words_len);
+}
+
+static uint64_t note_fields(void) {
+    // just the four fields, without hc_parse_note()'s note length division and name lookup
+    for (size_t i = 0; i < words_len; i++) {
+        uint32_t w = note_words[i];
+        out_fields[0][i] = HC_NOTE_ARTICULATION(w);
+        out_fields[1][i] = HC_NOTE_TRIPLET(w);
+        out_fields[2][i] = HC_NOTE_PITCH(w);
+        out_fields[3][i] = HC_NOTE_DURATION(w);
+    }
+
+    return sum_fields(words_len);
+}
+
+#ifdef SIMD
+__attribute__((target("sse2")))
+static uint64_t note_fields_sse2(void) {
+    size_t i = 0;
+
+    for (; i + 8 <= words_len; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(note_words + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(note_words + i + 4));
+        __m128i f[4][2];
+        for (int h = 0; h < 2; h++) {
+            __m128i w = h ? b : a;
+            f[0][h] = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(w, 14), _mm_set1_epi32(014)),
+                                   _mm_srli_epi32(_mm_and_si128(w, _mm_set1_epi32(060000)), 13));
+            f[1][h] = _mm_srli_epi32(_mm_and_si128(w, _mm_set1_epi32(0100000)), 15);
+            f[2][h] = _mm_and_si128(_mm_srli_epi32(w, 7), _mm_set1_epi32(077));
+            f[3][h] = _mm_and_si128(w, _mm_set1_epi32(0177));
+        }
+        for (int k = 0; k < 4; k++) {
+            // every field fits a byte, so the saturating packs just narrow
+            __m128i narrow = _mm_packus_epi16(_mm_packs_epi32(f[k][0], f[k][1]), _mm_setzero_si128());
+            _mm_storel_epi64((__m128i *)(out_fields[k] + i), narrow);
+        }
+    }
+    for (; i < words_len; i++) {
+        uint32_t w = note_words[i];
+        out_fields[0][i] = HC_NOTE_ARTICULATION(w);
+        out_fields[1][i] = HC_NOTE_TRIPLET(w);
+        out_fields[2][i] = HC_NOTE_PITCH(w);
+        out_fields[3][i] = HC_NOTE_DURATION(w);
+    }
+
+    return sum_fields(words_len);
+}
+#endif
+
+/*
+ * tempo
+ */
+static uint64_t tempo_divide(void) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < words_len; i++) sum += hc_decode_tempo_quarter(tempo_words[i]);
+    return sum;
+}
+
+static uint64_t tempo_lookup(void) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < words_len; i++) sum += tempo_table[tempo_words[i] & 0077777];
+    return sum;
+}
+
+/*
+ * FIODEC
+ */
+static uint64_t parity_loop(void) {
+    for (size_t i = 0; i < text_len; i++) out_bytes[i] = (uint8_t)hc_fiodec_parity(codes[i]);
+    return sum_bytes(out_bytes, text_len);
+}
+
+static uint64_t parity_lookup(void) {
+    for (size_t i = 0; i < text_len; i++) out_bytes[i] = parity_table[codes[i]];
+    return sum_bytes(out_bytes, text_len);
+}
+
+// runs an encoder over the text in blocks as ascii2fiodec does, each block's output written to the devnull FILE
+static uint64_t fiodec_with(hc_fiodec_encoder_t *enc) {
+    uint64_t digest = 0;
+    int uc = 0;
+
+    for (size_t i = 0; i < text_len; i += FIODEC_BLOCK) {
+        size_t length = 0;
+        uc = enc(text + i, text_len - i < FIODEC_BLOCK ? text_len - i : FIODEC_BLOCK, uc, fiodec_out, &length);
+        fwrite(fiodec_out, 1, length, devnull);
+        digest = digest * 31 + sum_bytes(fiodec_out, length);
+    }
+    return digest;
+}
+
+static uint64_t fiodec_scalar(void) { return fiodec_with(hc_fiodec_encode_scalar); }
+#ifdef SIMD
+static uint64_t fiodec_sse(void) { return fiodec_with(hc_fiodec_encode_sse41); }
+static uint64_t fiodec_avx2(void) { return fiodec_with(hc_fiodec_encode_avx2); }
+#endif
+
+static int always(void) { return 1; }
+#ifdef SIMD
+static int has_sse2(void) { return __builtin_cpu_supports("sse2"); }
+static int has_ssse3(void) { return __builtin_cpu_supports("ssse3"); }
+static int has_sse41(void) { return __builtin_cpu_supports("sse4.1"); }
+static int has_avx2(void) { return __builtin_cpu_supports("avx2"); }
+#endif
+
+static const bench_t BENCHES[] = {
+    { "rpb", "scalar", rpb_scalar, always },
+#ifdef SIMD
+    { "rpb", "ssse3", rpb_ssse3, has_ssse3 },
+#endif
+    { "ppb", "stdio", ppb_stdio, always },
+    { "ppb", "buffer", ppb_buffer, always },
+#ifdef SIMD
+    { "ppb", "ssse3", ppb_ssse3, has_ssse3 },
+#endif
+    { "checksum", "scalar", checksum_scalar, always },
+    { "checksum", "deferred", checksum_deferred, always },
+#ifdef SIMD
+    { "checksum", "avx2", checksum_avx2, has_avx2 },
+#endif
+    { "parse_note", "hc_parse_note", note_parse, always },
+    { "parse_note", "fields", note_fields, always },
+#ifdef SIMD
+    { "parse_note", "sse2", note_fields_sse2, has_sse2 },
+#endif
+    { "tempo", "divide", tempo_divide, always },
+    { "tempo", "lookup", tempo_lookup, always },
+    { "parity", "loop", parity_loop, always },
+    { "parity", "lookup", parity_lookup, always },
+    { "fiodec", "scalar", fiodec_scalar, always },
+#ifdef SIMD
+    { "fiodec", "sse4.1", fiodec_sse, has_sse41 },
+    { "fiodec", "avx2", fiodec_avx2, has_avx2 },
+#endif
+};
+
+// bytes of tape (or text) a kernel's run covers, for the per-byte figures
+static size_t bench_bytes(const bench_t *b) {
+    if (!strcmp(b->kernel, "rpb")) return tape_len;
+    if (!strcmp(b->kernel, "parity") || !strcmp(b->kernel, "fiodec")) return text_len;
+    return words_len * 3;
+}
+
+static uint64_t rng_state = 1;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static int make_inputs(size_t size, const uint8_t *source, size_t source_len) {
+    static const uint32_t ARTICULATIONS[] = { 0, 1, 2, 4, 8 };
+
+    words_len = size / 3;
+    text_len = size;
+    tape = malloc(words_len * 3 + (words_len / GAP_EVERY + 1) * HC_INNER_GAP_FRAMES);
+    words = malloc(words_len * sizeof(uint32_t) + 64);
+    note_words = malloc(words_len * sizeof(uint32_t) + 64);
+    tempo_words = malloc(words_len * sizeof(uint32_t) + 64);
+    out_words = malloc(words_len * sizeof(uint32_t) + 64);
+    out_bytes = malloc(size + 64);
+    text = malloc(size);
+    codes = malloc(size);
+    for (int f = 0; f < 4; f++) out_fields[f] = malloc(words_len + 64);
+    if (!tape || !words || !note_words || !tempo_words || !out_words || !out_bytes || !text || !codes
+        || !out_fields[0] || !out_fields[1] || !out_fields[2] || !out_fields[3]) {
+        return -1;
+    }
+
+    tape_len = 0;
+    for (size_t i = 0; i < words_len; i++) {
+        uint32_t art = ARTICULATIONS[rng() % 5];
+        words[i] = rng() & 0777777;
+        note_words[i] = HC_NOTE_WORD(art, rng() & 1, rng() % 64, 1 + rng() % 64);
+        tempo_words[i] = HC_TEMPO_MASK | (1 + rng() % 0077777);
+        if (i % GAP_EVERY == 0) {
+            for (int g = 0; g < HC_INNER_GAP_FRAMES; g++) tape[tape_len++] = 0;
+        }
+        tape[tape_len++] = 0200 | ((words[i] & 0770000) >> 12);
+        tape[tape_len++] = 0200 | ((words[i] & 0007700) >> 6);
+        tape[tape_len++] = 0200 | (words[i] & 0000077);
+    }
+
+    // the song's sources over and over, as the compiler input would be
+    for (size_t i = 0; i < text_len; i++) {
+        text[i] = source[i % source_len];
+        codes[i] = rng() & 077;
+    }
+
+    return 0;
+}
+
+static void free_inputs(void) {
+    free(tape);
+    free(words);
+    free(note_words);
+    free(tempo_words);
+    free(out_words);
+    free(out_bytes);
+    free(text);
+    free(codes);
+    for (int f = 0; f < 4; f++) free(out_fields[f]);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t cycles(void) {
+#ifdef SIMD
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static size_t parse_size(const char *s, char **end) {
+    size_t size = strtoull(s, end, 10);
+    switch (**end) {
+        case 'k': case 'K': (*end)++; return size << 10;
+        case 'm': case 'M': (*end)++; return size << 20;
+        case 'g': case 'G': (*end)++; return size << 30;
+        default: return size;
+    }
+}
+
+// a few KB of real Harmony Compiler source, or a stand-in when not run from the repo
+static uint8_t *load_source(size_t *len) {
+    static const char *VOICES[] = { "voices/melody.txt", "voices/bass2.txt", "voices/bass1.txt", "voices/bass0.txt" };
+    static const char FALLBACK[] = "tempo 99\ntreble\nkey (5\nunits 32\n\n1 rest 7\n8 rt2 rt4 7lt8 9l,/\n";
+    uint8_t *source = NULL;
+
+    *len = 0;
+    for (int v = 0; v < 4; v++) {
+        FILE *fp = fopen(VOICES[v], "rb");
+        if (!fp) continue;
+        uint8_t block[4096];
+        size_t n;
+        while ((n = fread(block, 1, sizeof(block), fp)) > 0) {
+            uint8_t *grown = realloc(source, *len + n);
+            if (!grown) break;
+            source = grown;
+            memcpy(source + *len, block, n);
+            *len += n;
+        }
+        fclose(fp);
+    }
+    if (!*len) {
+        source = (uint8_t *)strdup(FALLBACK);
+        *len = strlen(FALLBACK);
+    }
+
+    return source;
+}
+
+int main(int argc, char *argv[]) {
+    const char *sizes = DEFAULT_SIZES;
+    const char *only = NULL;
+    int runs = DEFAULT_RUNS;
+    int warmups = DEFAULT_WARMUPS;
+    int opt;
+    int mismatches = 0;
+
+    while ((opt = getopt(argc, argv, "s:r:w:k:h")) != -1) {
+        switch (opt) {
+            case 's': sizes = optarg; break;
+            case 'r': runs = atoi(optarg); break;
+            case 'w': warmups = atoi(optarg); break;
+            case 'k': only = optarg; break;
+            default:
+                fprintf(stderr,
+                    "Usage: ./microbench [-s <sizes>] [-r <runs>] [-w <warmups>] [-k <kernel>]\n"
+                    "  -s  comma separated input sizes in bytes, with k/M/G suffixes (default: %s)\n"
+                    "  -r  timed runs per variant, the fastest is reported (default: %d)\n"
+                    "  -w  untimed warmup runs per variant (default: %d)\n"
+                    "  -k  only the kernel with this name\n",
+                    DEFAULT_SIZES, DEFAULT_RUNS, DEFAULT_WARMUPS);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (runs < 1) runs = 1;
+
+    devnull = fopen("/dev/null", "wb");
+    if (!devnull) {
+        perror("microbench");
+        return 1;
+    }
+
+    hc_fiodec_init();
+    for (uint32_t t = 1; t < 0100000; t++) tempo_table[t] = (uint16_t)(11436 / t);
+    for (int c = 0; c < 0100; c++) parity_table[c] = (uint8_t)hc_fiodec_parity(c);
+
+#ifdef SIMD
+    __builtin_cpu_init();
+#endif
+
+    size_t source_len;
+    uint8_t *source = load_source(&source_len);
+
+    printf("%-11s %-14s %9s %10s %12s %10s\n", "kernel", "variant", "bytes", "ns/byte", "cycles/byte", "MB/s");
+    for (const char *s = sizes; *s; ) {
+        char *end;
+        size_t size = parse_size(s, &end);
+        s = *end == ',' ? end + 1 : end;
+        if (!size) continue;
+
+        if (make_inputs(size, source, source_len)) {
+            fprintf(stderr, "out of memory for %zu bytes\n", size);
+            return 1;
+        }
+
+        const char *kernel = NULL;
+        uint64_t expected = 0;
+        for (size_t b = 0; b < sizeof(BENCHES) / sizeof(BENCHES[0]); b++) {
+            const bench_t *bench = &BENCHES[b];
+            if (only && strcmp(only, bench->kernel)) continue;
+            if (!bench->supported()) continue;
+
+            uint64_t digest = bench->run();
+            for (int w = 1; w < warmups; w++) bench->run();
+
+            if (!kernel || strcmp(kernel, bench->kernel)) {
+                kernel = bench->kernel;
+                expected = digest;
+            } else if (digest != expected) {
+                fprintf(stderr, "%s %s: result %llx differs from %llx\n", bench->kernel, bench->variant,
+                    (unsigned long long)digest, (unsigned long long)expected);
+                mismatches++;
+            }
+
+            double best_ns = 0;
+            uint64_t best_cycles = 0;
+            for (int r = 0; r < runs; r++) {
+                double start = now_ns();
+                uint64_t start_cycles = cycles();
+                bench->run();
+                uint64_t elapsed_cycles = cycles() - start_cycles;
+                double elapsed = now_ns() - start;
+                if (!r || elapsed < best_ns) {
+                    best_ns = elapsed;
+                    best_cycles = elapsed_cycles;
+                }
+            }
+
+            size_t bytes = bench_bytes(bench);
+            printf("%-11s %-14s %9zu %10.3f %12.3f %10.1f\n", bench->kernel, bench->variant, bytes,
+                best_ns / bytes, (double)best_cycles / bytes, bytes / best_ns * 1e3);
+        }
+
+        free_inputs();
+    }
+
+    free(source);
+    return mismatches ? 1 : 0;
+}
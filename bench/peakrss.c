@@ -0,0 +1,80 @@
+/*
+ * peakrss.c
+ *
+ * This program runs a command and appends the command's peak RSS in kilobytes to a file, for bench/e2e.py. A process
+ * forked from the Python driver keeps the interpreter's high-water mark through exec, so the driver can't measure a
+ * native tool itself; this program is small, and the command it forks starts from that. The command's exit status is
+ * passed back, or 128 plus the signal that killed it.
+ * Usage: ./peakrss <file> <command> [arguments...]
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <file> <command> [arguments...]\n", argv[0]);
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+#ifdef __linux__
+        // a timeout kills this process, take the command with it
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+        execvp(argv[2], argv + 2);
+        perror(argv[2]);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        perror("wait4");
+        return 1;
+    }
+
+    FILE *fp = fopen(argv[1], "a");
+    if (!fp) {
+        perror(argv[1]);
+        return 1;
+    }
+    fprintf(fp, "%ld\n", usage.ru_maxrss);
+    fclose(fp);
+
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
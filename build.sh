@@ -1,7 +1,8 @@
 rm hc_binmaker/ascii2fiodec title/ascii2fiodec hc_binmaker/pdp1 title/pdp1
 
-gcc -o hc_binmaker/ascii2fiodec hc_binmaker/src/ascii2fiodec.c
+gcc -O2 -o hc_binmaker/ascii2fiodec hc_binmaker/src/ascii2fiodec.c
 cp hc_binmaker/ascii2fiodec title/
+gcc -O2 -o hc_binmaker/splice hc_binmaker/src/splice.c
 
 unzip hc_binmaker/src/simhv36-1.zip -d hc_binmaker/src/simhv36-1
 cd hc_binmaker/src/simhv36-1
@@ -22,4 +23,19 @@ cd ..
 
 gcc -o tweak/tweak tweak/tweak.c
 
-gcc -o verify/decodehcint verify/decodehcint.c
\ No newline at end of file
+gcc -o verify/decodehcint verify/decodehcint.c -lm -lpthread
+gcc -O2 -o verify/dumptape verify/dumptape.c
+gcc -O2 -o verify/salvage verify/salvage.c
+gcc -O3 -o verify/pitchcheck verify/pitchcheck.c -lm -lpthread
+
+gcc -O2 -o title/banner title/banner.c
+
+gcc -O2 -o render/render render/render.c -lm -lpthread
+
+gcc -O2 -o bench/gentape bench/gentape.c
+gcc -O2 -o bench/microbench bench/microbench.c -lm
+gcc -O2 -o bench/peakrss bench/peakrss.c
+
+gcc -O2 -o archive/hcar archive/hcar.c -lm
+
+gcc -O2 -o punch/punch punch/punch.c -lm
@@ -0,0 +1,722 @@
+/*
+ * hcarchive.h
+ *
+ * A library of intermediate tapes in one file, read through mmap. The file starts with an index of every tape, its
+ * voices and their parts (offsets, word counts, checksums, tempo, duration) and content hashes, so listing and
+ * searching read only the index, and extracting a tape copies its pieces straight out of the mapping.
+ *
+ * Every tape is stored as a list of segments, alternately the blank gap before a part and the part itself, ending with
+ * the trailer. Each segment's bytes are kept once per archive however many tapes use them, so variants that only
+ * change a tempo word or the title art add just the parts that differ. Extraction gives back the original tape
+ * byte for byte.
+ *
+ * Layout, all integers little-endian, every table 8 byte aligned:
+ *   header
+ *   tapes       hc_archive_tape_t, sorted by name
+ *   voices      hc_archive_voice_t, each tape's together
+ *   segments    uint32_t blob indexes, each tape's together
+ *   blobs       hc_archive_blob_t
+ *   names       tape names, not NUL terminated
+ *   data        blob bytes
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HCARCHIVE_H
+#define HCARCHIVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hctape.h"
+
+#define HC_ARCHIVE_MAGIC "HCAR"
+#define HC_ARCHIVE_VERSION 1
+
+typedef enum {
+    HC_BLOB_GAP = 0,                // blank frames before a part, or the trailer
+    HC_BLOB_NOTES = 1,
+    HC_BLOB_BARS = 2,
+} hc_blob_kind_t;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t tapes_count;
+    uint32_t voices_count;
+    uint32_t segments_count;
+    uint32_t blobs_count;
+    uint64_t tapes_offset;
+    uint64_t voices_offset;
+    uint64_t segments_offset;
+    uint64_t blobs_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint64_t data_offset;
+    uint64_t data_size;
+} hc_archive_header_t;
+
+typedef struct {
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t first_voice;
+    uint32_t voices_count;
+    uint32_t first_segment;
+    uint32_t segments_count;
+    uint64_t bytes;                 // tape length
+    uint64_t hash;                  // FNV-1a of the whole tape
+    uint64_t duration_us;           // longest voice, at the PDP-1's specified speed
+    uint32_t tempo;                 // raw tempo every voice starts at (hc_song_tempo)
+    uint32_t reserved;
+} hc_archive_tape_t;
+
+typedef struct {
+    uint64_t notes_offset;          // byte offsets of the parts in the tape
+    uint64_t bars_offset;
+    uint32_t notes_blob;
+    uint32_t bars_blob;
+    uint32_t notes_words;           // data words, without the count and checksum
+    uint32_t bars_words;
+    uint32_t notes_checksum;
+    uint32_t bars_checksum;
+    uint32_t tempo;                 // raw tempo the voice starts at, the tape's
+    uint32_t tempo_changes;         // tempo words besides the tape's own
+    uint64_t duration_us;
+} hc_archive_voice_t;
+
+typedef struct {
+    uint64_t offset;                // from the start of the data area
+    uint32_t length;
+    uint32_t kind;                  // hc_blob_kind_t
+    uint64_t hash;                  // FNV-1a of the bytes
+} hc_archive_blob_t;
+
+static inline uint64_t hc_fnv1a(const uint8_t *data, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/*
+ * Reading
+ */
+typedef struct {
+    const uint8_t *map;
+    size_t size;
+    const hc_archive_header_t *header;
+    const hc_archive_tape_t *tapes;
+    const hc_archive_voice_t *voices;
+    const uint32_t *segments;
+    const hc_archive_blob_t *blobs;
+    const char *names;
+    const uint8_t *data;
+    char message[160];
+} hc_archive_t;
+
+static inline int hc_archive_fail(hc_archive_t *ar, const char *message) {
+    snprintf(ar->message, sizeof(ar->message), "%s", message);
+    return -1;
+}
+
+// table at offset with count entries of size bytes lies inside the file
+static inline int hc_archive_fits(const hc_archive_t *ar, uint64_t offset, uint64_t count, uint64_t size) {
+    return offset % 8 == 0 && offset <= ar->size && count <= (ar->size - offset) / (size ? size : 1);
+}
+
+/*
+ * Maps an archive and checks its index: every table inside the file, and every tape's voices, segments and name,
+ * and every blob's bytes, inside their tables. The data itself isn't read.
+ */
+static inline int hc_archive_open(hc_archive_t *ar, const char *path) {
+    struct stat st;
+    int fd;
+
+    memset(ar, 0, sizeof(*ar));
+    if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st)) {
+        snprintf(ar->message, sizeof(ar->message), "%s: %s", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(hc_archive_header_t)) {
+        close(fd);
+        return hc_archive_fail(ar, "not an archive, too short");
+    }
+
+    ar->size = st.st_size;
+    ar->map = mmap(NULL, ar->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ar->map == MAP_FAILED) {
+        ar->map = NULL;
+        return hc_archive_fail(ar, "could not map the archive");
+    }
+
+    const hc_archive_header_t *h = ar->header = (const hc_archive_header_t *)ar->map;
+    if (memcmp(h->magic, HC_ARCHIVE_MAGIC, 4)) return hc_archive_fail(ar, "not an archive, bad magic");
+    if (h->version != HC_ARCHIVE_VERSION) return hc_archive_fail(ar, "unsupported archive version");
+    if (!hc_archive_fits(ar, h->tapes_offset, h->tapes_count, sizeof(hc_archive_tape_t))
+        || !hc_archive_fits(ar, h->voices_offset, h->voices_count, sizeof(hc_archive_voice_t))
+        || !hc_archive_fits(ar, h->segments_offset, h->segments_count, sizeof(uint32_t))
+        || !hc_archive_fits(ar, h->blobs_offset, h->blobs_count, sizeof(hc_archive_blob_t))
+        || !hc_archive_fits(ar, h->names_offset, h->names_size, 1)
+        || !hc_archive_fits(ar, h->data_offset, h->data_size, 1)) {
+        return hc_archive_fail(ar, "index table outside the archive");
+    }
+
+    ar->tapes = (const hc_archive_tape_t *)(ar->map + h->tapes_offset);
+    ar->voices = (const hc_archive_voice_t *)(ar->map + h->voices_offset);
+    ar->segments = (const uint32_t *)(ar->map + h->segments_offset);
+    ar->blobs = (const hc_archive_blob_t *)(ar->map + h->blobs_offset);
+    ar->names = (const char *)(ar->map + h->names_offset);
+    ar->data = ar->map + h->data_offset;
+
+    for (uint32_t i = 0; i < h->tapes_count; i++) {
+        const hc_archive_tape_t *t = &ar->tapes[i];
+        if ((uint64_t)t->first_voice + t->voices_count > h->voices_count
+            || (uint64_t)t->first_segment + t->segments_count > h->segments_count
+            || (uint64_t)t->name_offset + t->name_length > h->names_size) {
+            return hc_archive_fail(ar, "tape record out of range");
+        }
+    }
+    for (uint32_t i = 0; i < h->voices_count; i++) {
+        if (ar->voices[i].notes_blob >= h->blobs_count || ar->voices[i].bars_blob >= h->blobs_count) {
+            return hc_archive_fail(ar, "voice record out of range");
+        }
+    }
+    for (uint32_t i = 0; i < h->segments_count; i++) {
+        if (ar->segments[i] >= h->blobs_count) return hc_archive_fail(ar, "segment out of range");
+    }
+    for (uint32_t i = 0; i < h->blobs_count; i++) {
+        if (ar->blobs[i].offset > h->data_size || ar->blobs[i].length > h->data_size - ar->blobs[i].offset) {
+            return hc_archive_fail(ar, "blob outside the data area");
+        }
+    }
+
+    return 0;
+}
+
+static inline void hc_archive_close(hc_archive_t *ar) {
+    if (ar->map) munmap((void *)ar->map, ar->size);
+    memset(ar, 0, sizeof(*ar));
+}
+
+static inline int hc_archive_name_cmp(const hc_archive_t *ar, const hc_archive_tape_t *t, const char *name) {
+    size_t length = strlen(name);
+    int cmp = memcmp(ar->names + t->name_offset, name, t->name_length < length ? t->name_length : length);
+    if (cmp) return cmp;
+    return t->name_length < length ? -1 : t->name_length > length;
+}
+
+// binary search of the sorted tape table, returns the tape's index or -1
+static inline long hc_archive_find(const hc_archive_t *ar, const char *name) {
+    long lo = 0;
+    long hi = (long)ar->header->tapes_count - 1;
+
+    while (lo <= hi) {
+        long mid = lo + (hi - lo) / 2;
+        int cmp = hc_archive_name_cmp(ar, &ar->tapes[mid], name);
+        if (!cmp) return mid;
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    return -1;
+}
+
+static inline const uint8_t *hc_archive_blob_data(const hc_archive_t *ar, uint32_t blob) {
+    return ar->data + ar->blobs[blob].offset;
+}
+
+// writes a tape exactly as it was added
+static inline int hc_archive_extract(const hc_archive_t *ar, uint32_t tape, FILE *fp) {
+    const hc_archive_tape_t *t = &ar->tapes[tape];
+
+    for (uint32_t s = 0; s < t->segments_count; s++) {
+        const hc_archive_blob_t *b = &ar->blobs[ar->segments[t->first_segment + s]];
+        if (fwrite(ar->data + b->offset, 1, b->length, fp) != b->length) return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Writing. A builder collects tapes, from tape images or from an archive being rewritten, keeping one copy of each
+ * distinct blob, then writes a new archive in one go.
+ */
+typedef struct {
+    char *name;
+    hc_archive_tape_t tape;         // the table indexes in here are local to the tape until it's written
+    hc_archive_voice_t *voices;
+    uint32_t *segments;
+} hc_archive_entry_t;
+
+typedef struct {
+    hc_archive_entry_t *entries;
+    uint32_t entries_count;
+    uint32_t entries_capacity;
+    hc_archive_blob_t *blobs;
+    uint32_t blobs_count;
+    uint32_t blobs_capacity;
+    uint8_t *data;
+    uint64_t data_size;
+    uint64_t data_capacity;
+    uint32_t *table;                // open addressing on blob hash, blob index + 1, 0 for empty
+    uint32_t table_size;
+    char message[160];
+} hc_archive_builder_t;
+
+static inline void hc_archive_builder_init(hc_archive_builder_t *b) {
+    memset(b, 0, sizeof(*b));
+}
+
+static inline void hc_archive_builder_free(hc_archive_builder_t *b) {
+    for (uint32_t i = 0; i < b->entries_count; i++) {
+        free(b->entries[i].name);
+        free(b->entries[i].voices);
+        free(b->entries[i].segments);
+    }
+    free(b->entries);
+    free(b->blobs);
+    free(b->data);
+    free(b->table);
+    memset(b, 0, sizeof(*b));
+}
+
+static inline int hc_archive_builder_fail(hc_archive_builder_t *b, const char *message) {
+    snprintf(b->message, sizeof(b->message), "%s", message);
+    return -1;
+}
+
+static inline int hc_archive_rehash(hc_archive_builder_t *b) {
+    uint32_t size = b->table_size ? b->table_size * 2 : 1024;
+    uint32_t *table = calloc(size, sizeof(uint32_t));
+    if (!table) return -1;
+
+    for (uint32_t i = 0; i < b->blobs_count; i++) {
+        uint32_t slot = (uint32_t)b->blobs[i].hash & (size - 1);
+        while (table[slot]) slot = (slot + 1) & (size - 1);
+        table[slot] = i + 1;
+    }
+    free(b->table);
+    b->table = table;
+    b->table_size = size;
+    return 0;
+}
+
+// index of the blob holding these bytes, stored now if it's the first time they're seen; -1 when out of memory
+static inline long hc_archive_blob(hc_archive_builder_t *b, hc_blob_kind_t kind, const uint8_t *bytes, uint32_t length) {
+    uint64_t hash = hc_fnv1a(bytes, length);
+
+    if ((b->blobs_count + 1) * 2 > b->table_size && hc_archive_rehash(b)) return -1;
+
+    uint32_t slot = (uint32_t)hash & (b->table_size - 1);
+    for (; b->table[slot]; slot = (slot + 1) & (b->table_size - 1)) {
+        const hc_archive_blob_t *blob = &b->blobs[b->table[slot] - 1];
+        if (blob->hash == hash && blob->length == length && blob->kind == (uint32_t)kind
+            && !memcmp(b->data + blob->offset, bytes, length)) {
+            return b->table[slot] - 1;
+        }
+    }
+
+    if (b->blobs_count == b->blobs_capacity) {
+        b->blobs_capacity = b->blobs_capacity ? b->blobs_capacity * 2 : 64;
+        hc_archive_blob_t *blobs = realloc(b->blobs, b->blobs_capacity * sizeof(hc_archive_blob_t));
+        if (!blobs) return -1;
+        b->blobs = blobs;
+    }
+    if (b->data_size + length > b->data_capacity) {
+        uint64_t capacity = b->data_capacity ? b->data_capacity : 65536;
+        while (capacity < b->data_size + length) capacity *= 2;
+        uint8_t *data = realloc(b->data, capacity);
+        if (!data) return -1;
+        b->data = data;
+        b->data_capacity = capacity;
+    }
+
+    hc_archive_blob_t *blob = &b->blobs[b->blobs_count];
+    blob->offset = b->data_size;
+    blob->length = length;
+    blob->kind = kind;
+    blob->hash = hash;
+    memcpy(b->data + b->data_size, bytes, length);
+    b->data_size += length;
+    b->table[slot] = ++b->blobs_count;
+    return blob - b->blobs;
+}
+
+// the entry for name, replacing any tape already added under it; NULL when out of memory
+static inline hc_archive_entry_t *hc_archive_entry(hc_archive_builder_t *b, const char *name) {
+    hc_archive_entry_t *e = NULL;
+
+    for (uint32_t i = 0; i < b->entries_count; i++) {
+        if (!strcmp(b->entries[i].name, name)) {
+            e = &b->entries[i];
+            free(e->voices);
+            free(e->segments);
+            break;
+        }
+    }
+    if (!e) {
+        if (b->entries_count == b->entries_capacity) {
+            b->entries_capacity = b->entries_capacity ? b->entries_capacity * 2 : 64;
+            hc_archive_entry_t *entries = realloc(b->entries, b->entries_capacity * sizeof(hc_archive_entry_t));
+            if (!entries) return NULL;
+            b->entries = entries;
+        }
+        e = &b->entries[b->entries_count++];
+        e->name = strdup(name);
+        if (!e->name) {
+            b->entries_count--;
+            return NULL;
+        }
+    }
+
+    memset(&e->tape, 0, sizeof(e->tape));
+    e->voices = NULL;
+    e->segments = NULL;
+    return e;
+}
+
+static inline void hc_archive_remove(hc_archive_builder_t *b, uint32_t entry) {
+    hc_archive_entry_t *e = &b->entries[entry];
+    free(e->name);
+    free(e->voices);
+    free(e->segments);
+    memmove(e, e + 1, (b->entries_count - entry - 1) * sizeof(hc_archive_entry_t));
+    b->entries_count--;
+}
+
+// duration and tempo of a voice, as the player steps through it from the tape's tempo (hc_song_tempo)
+static inline int hc_archive_voice_timing(const hc_voice_t *v, uint32_t song_tempo, int first,
+                                          hc_archive_voice_t *av) {
+    hc_event_t *events;
+    long count = hc_voice_events(v, song_tempo, &events);
+    double seconds = 0;
+
+    if (count < 0) return -1;
+    for (long i = 0; i < count; i++) seconds += events[i].ticks * hc_tick_seconds(events[i].tempo);
+    free(events);
+
+    // tempo words ahead of the first voice's first note set the tape's tempo, any other tempo word is a change
+    uint32_t tempos = 0;
+    uint32_t leading = 0;
+    for (uint32_t i = 0; i < v->notes_count; i++) {
+        int tempo = (v->notes[i] & HC_TEMPO_MASK) == HC_TEMPO_MASK;
+        if (tempo && first && tempos == i) leading++;
+        tempos += tempo;
+    }
+    av->tempo = song_tempo;
+    av->tempo_changes = tempos - leading;
+    av->duration_us = (uint64_t)(seconds * 1e6 + 0.5);
+    return 0;
+}
+
+/*
+ * Adds a tape image under a name. The tape is decoded (every part checksummed) for the index, and cut into gap and
+ * part segments at the first frame of each part's word count and after the last frame of its checksum.
+ */
+static inline int hc_archive_add(hc_archive_builder_t *b, const char *name, const uint8_t *tape, size_t length) {
+    hc_decoder_t decoder;
+    hc_framer_t framer = {0};
+    hc_parts_t parts;
+    uint32_t word;
+    size_t word_start = 0;
+    size_t gap_start = 0;
+    size_t part_start = 0;
+    uint32_t segments_capacity = 0;
+    long blob;
+
+    if (length > UINT32_MAX) return hc_archive_builder_fail(b, "tape too long");
+
+    hc_decoder_init(&decoder);
+    if (hc_decoder_feed(&decoder, tape, length) < 0 || hc_decoder_finish(&decoder) < 0) {
+        hc_archive_builder_fail(b, decoder.message);
+        hc_decoder_free(&decoder);
+        return -1;
+    }
+    if (!decoder.voices_count) {
+        hc_decoder_free(&decoder);
+        return hc_archive_builder_fail(b, "no voices on tape");
+    }
+
+    hc_archive_entry_t *e = hc_archive_entry(b, name);
+    if (!e) goto oom;
+    e->tape.bytes = length;
+    e->tape.hash = hc_fnv1a(tape, length);
+    e->tape.voices_count = decoder.voices_count;
+    e->voices = calloc(decoder.voices_count, sizeof(hc_archive_voice_t));
+    segments_capacity = decoder.voices_count * 4 + 1;
+    e->segments = malloc(segments_capacity * sizeof(uint32_t));
+    if (!e->voices || !e->segments) goto oom;
+
+    uint32_t song_tempo = hc_song_tempo(&decoder.voices[0]);
+    for (uint32_t v = 0; v < decoder.voices_count; v++) {
+        hc_archive_voice_t *av = &e->voices[v];
+        const hc_voice_t *voice = &decoder.voices[v];
+        av->notes_words = voice->notes_count;
+        av->bars_words = voice->bars_count;
+        for (uint32_t i = 0; i < voice->notes_count; i++) av->notes_checksum = hc_add_1s_complement(av->notes_checksum, voice->notes[i]);
+        for (uint32_t i = 0; i < voice->bars_count; i++) av->bars_checksum = hc_add_1s_complement(av->bars_checksum, voice->bars[i]);
+        if (hc_archive_voice_timing(voice, song_tempo, v == 0, av)) goto oom;
+        if (av->duration_us > e->tape.duration_us) e->tape.duration_us = av->duration_us;
+    }
+    e->tape.tempo = song_tempo;
+    hc_decoder_free(&decoder);
+
+    // the decoder already checked the structure, so this pass only finds where the parts are
+    hc_parts_init(&parts);
+    for (size_t i = 0; i < length; i++) {
+        if ((tape[i] & 0200) && !framer.frames) word_start = i;
+        if (!hc_framer_push(&framer, tape[i], &word)) continue;
+        hc_framer_next(&framer);
+
+        hc_word_kind_t kind = hc_parts_push(&parts, word);
+        if (kind == HC_WORD_COUNT) {
+            part_start = word_start;
+            if ((blob = hc_archive_blob(b, HC_BLOB_GAP, tape + gap_start, part_start - gap_start)) < 0) goto oom;
+            e->segments[e->tape.segments_count++] = blob;
+        } else if (kind != HC_WORD_DATA) {
+            hc_archive_voice_t *av = &e->voices[parts.voice - 1];
+            hc_blob_kind_t part_kind = parts.kind == HC_PART_NOTES ? HC_BLOB_NOTES : HC_BLOB_BARS;
+            if ((blob = hc_archive_blob(b, part_kind, tape + part_start, i + 1 - part_start)) < 0) goto oom;
+            e->segments[e->tape.segments_count++] = blob;
+            if (part_kind == HC_BLOB_NOTES) {
+                av->notes_offset = part_start;
+                av->notes_blob = blob;
+            } else {
+                av->bars_offset = part_start;
+                av->bars_blob = blob;
+            }
+            gap_start = i + 1;
+        }
+    }
+    if ((blob = hc_archive_blob(b, HC_BLOB_GAP, tape + gap_start, length - gap_start)) < 0) goto oom;
+    e->segments[e->tape.segments_count++] = blob;
+    return 0;
+
+oom:
+    hc_decoder_free(&decoder);
+    if (e) hc_archive_remove(b, e - b->entries);
+    return hc_archive_builder_fail(b, "out of memory");
+}
+
+// copies a tape from an open archive, without decoding it again
+static inline int hc_archive_import(hc_archive_builder_t *b, const hc_archive_t *ar, uint32_t tape) {
+    const hc_archive_tape_t *t = &ar->tapes[tape];
+    char *name = strndup(ar->names + t->name_offset, t->name_length);
+    long blob;
+
+    if (!name) return hc_archive_builder_fail(b, "out of memory");
+    hc_archive_entry_t *e = hc_archive_entry(b, name);
+    free(name);
+    if (!e) return hc_archive_builder_fail(b, "out of memory");
+
+    e->tape = *t;
+    e->voices = malloc((t->voices_count ? t->voices_count : 1) * sizeof(hc_archive_voice_t));
+    e->segments = malloc((t->segments_count ? t->segments_count : 1) * sizeof(uint32_t));
+    if (!e->voices || !e->segments) goto oom;
+    memcpy(e->voices, ar->voices + t->first_voice, t->voices_count * sizeof(hc_archive_voice_t));
+
+    for (uint32_t s = 0; s < t->segments_count; s++) {
+        const hc_archive_blob_t *old = &ar->blobs[ar->segments[t->first_segment + s]];
+        if ((blob = hc_archive_blob(b, (hc_blob_kind_t)old->kind, ar->data + old->offset, old->length)) < 0) goto oom;
+        e->segments[s] = blob;
+
+        // voices point at the same blobs as their segments, renumber them to match
+        for (uint32_t v = 0; v < t->voices_count; v++) {
+            if (ar->voices[t->first_voice + v].notes_blob == ar->segments[t->first_segment + s]) e->voices[v].notes_blob = blob;
+            if (ar->voices[t->first_voice + v].bars_blob == ar->segments[t->first_segment + s]) e->voices[v].bars_blob = blob;
+        }
+    }
+    return 0;
+
+oom:
+    hc_archive_remove(b, e - b->entries);
+    return hc_archive_builder_fail(b, "out of memory");
+}
+
+static inline int hc_archive_entry_cmp(const void *a, const void *b) {
+    return strcmp(((const hc_archive_entry_t *)a)->name, ((const hc_archive_entry_t *)b)->name);
+}
+
+static inline uint64_t hc_archive_align(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+static inline int hc_archive_pad(FILE *fp, uint64_t *offset) {
+    while (*offset % 8) {
+        if (putc(0, fp) == EOF) return -1;
+        (*offset)++;
+    }
+    return 0;
+}
+
+/*
+ * Writes the archive to path, through a temporary file renamed into place, so readers never see a partial archive
+ * and the old one stays whole if anything fails. Only blobs some tape still uses are written.
+ */
+static inline int hc_archive_write(hc_archive_builder_t *b, const char *path) {
+    hc_archive_header_t h;
+    uint32_t *renumber = NULL;
+    char *temp = NULL;
+    FILE *fp = NULL;
+    uint64_t offset;
+    uint64_t name_offset = 0;
+
+    qsort(b->entries, b->entries_count, sizeof(hc_archive_entry_t), hc_archive_entry_cmp);
+
+    // blobs in the order tapes use them, so a tape's pieces sit together in the data area
+    renumber = malloc((b->blobs_count ? b->blobs_count : 1) * sizeof(uint32_t));
+    temp = malloc(strlen(path) + 16);
+    if (!renumber || !temp) goto fail;
+    memset(renumber, 0xff, b->blobs_count * sizeof(uint32_t));
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, HC_ARCHIVE_MAGIC, 4);
+    h.version = HC_ARCHIVE_VERSION;
+    h.tapes_count = b->entries_count;
+    for (uint32_t i = 0; i < b->entries_count; i++) {
+        const hc_archive_entry_t *e = &b->entries[i];
+        h.voices_count += e->tape.voices_count;
+        h.segments_count += e->tape.segments_count;
+        h.names_size += strlen(e->name);
+        for (uint32_t s = 0; s < e->tape.segments_count; s++) {
+            if (renumber[e->segments[s]] == UINT32_MAX) {
+                renumber[e->segments[s]] = h.blobs_count++;
+                h.data_size += b->blobs[e->segments[s]].length;
+            }
+        }
+    }
+    h.tapes_offset = hc_archive_align(sizeof(h));
+    h.voices_offset = hc_archive_align(h.tapes_offset + (uint64_t)h.tapes_count * sizeof(hc_archive_tape_t));
+    h.segments_offset = hc_archive_align(h.voices_offset + (uint64_t)h.voices_count * sizeof(hc_archive_voice_t));
+    h.blobs_offset = hc_archive_align(h.segments_offset + (uint64_t)h.segments_count * sizeof(uint32_t));
+    h.names_offset = hc_archive_align(h.blobs_offset + (uint64_t)h.blobs_count * sizeof(hc_archive_blob_t));
+    h.data_offset = hc_archive_align(h.names_offset + h.names_size);
+
+    sprintf(temp, "%s.tmp%d", path, (int)getpid());
+    if (!(fp = fopen(temp, "wb"))) goto fail;
+    if (fwrite(&h, sizeof(h), 1, fp) != 1) goto fail;
+    offset = sizeof(h);
+
+    uint32_t voice = 0;
+    uint32_t segment = 0;
+    if (hc_archive_pad(fp, &offset)) goto fail;
+    for (uint32_t i = 0; i < b->entries_count; i++) {
+        hc_archive_tape_t t = b->entries[i].tape;
+        t.name_offset = name_offset;
+        t.name_length = strlen(b->entries[i].name);
+        t.first_voice = voice;
+        t.first_segment = segment;
+        name_offset += t.name_length;
+        voice += t.voices_count;
+        segment += t.segments_count;
+        if (fwrite(&t, sizeof(t), 1, fp) != 1) goto fail;
+        offset += sizeof(t);
+    }
+
+    if (hc_archive_pad(fp, &offset)) goto fail;
+    for (uint32_t i = 0; i < b->entries_count; i++) {
+        for (uint32_t v = 0; v < b->entries[i].tape.voices_count; v++) {
+            hc_archive_voice_t av = b->entries[i].voices[v];
+            av.notes_blob = renumber[av.notes_blob];
+            av.bars_blob = renumber[av.bars_blob];
+            if (fwrite(&av, sizeof(av), 1, fp) != 1) goto fail;
+            offset += sizeof(av);
+        }
+    }
+
+    if (hc_archive_pad(fp, &offset)) goto fail;
+    for (uint32_t i = 0; i < b->entries_count; i++) {
+        for (uint32_t s = 0; s < b->entries[i].tape.segments_count; s++) {
+            uint32_t blob = renumber[b->entries[i].segments[s]];
+            if (fwrite(&blob, sizeof(blob), 1, fp) != 1) goto fail;
+            offset += sizeof(blob);
+        }
+    }
+
+    // blob records and data both in their new order
+    uint32_t *order = malloc((h.blobs_count ? h.blobs_count : 1) * sizeof(uint32_t));
+    if (!order) goto fail;
+    for (uint32_t i = 0; i < b->blobs_count; i++) {
+        if (renumber[i] != UINT32_MAX) order[renumber[i]] = i;
+    }
+
+    if (hc_archive_pad(fp, &offset)) goto fail_order;
+    uint64_t data_offset = 0;
+    for (uint32_t i = 0; i < h.blobs_count; i++) {
+        hc_archive_blob_t blob = b->blobs[order[i]];
+        blob.offset = data_offset;
+        data_offset += blob.length;
+        if (fwrite(&blob, sizeof(blob), 1, fp) != 1) goto fail_order;
+        offset += sizeof(blob);
+    }
+
+    if (hc_archive_pad(fp, &offset)) goto fail_order;
+    for (uint32_t i = 0; i < b->entries_count; i++) {
+        size_t length = strlen(b->entries[i].name);
+        if (fwrite(b->entries[i].name, 1, length, fp) != length) goto fail_order;
+        offset += length;
+    }
+
+    if (hc_archive_pad(fp, &offset)) goto fail_order;
+    for (uint32_t i = 0; i < h.blobs_count; i++) {
+        const hc_archive_blob_t *blob = &b->blobs[order[i]];
+        if (fwrite(b->data + blob->offset, 1, blob->length, fp) != blob->length) goto fail_order;
+    }
+    free(order);
+
+    if (fclose(fp)) {
+        fp = NULL;
+        goto fail;
+    }
+    fp = NULL;
+    if (rename(temp, path)) goto fail;
+
+    free(renumber);
+    free(temp);
+    return 0;
+
+fail_order:
+    free(order);
+fail:
+    snprintf(b->message, sizeof(b->message), "%s: %s", path, strerror(errno));
+    if (fp) fclose(fp);
+    if (temp) unlink(temp);
+    free(renumber);
+    free(temp);
+    return -1;
+}
+
+#endif
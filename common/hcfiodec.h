@@ -0,0 +1,297 @@
+/*
+ * hcfiodec.h
+ *
+ * FIODEC, the PDP-1 typewriter code the Harmony Compiler reads its source in, as ascii2fiodec converts it: the case
+ * tables, encode and decode tables built from them at startup, and the ASCII to FIODEC encoders. On x86 the encoder
+ * looks up 16 (SSE4.1) or 32 (AVX2) characters at a time, picked at run time, and falls back to the scalar encoder for
+ * any block holding a character with no code or outside 7-bit ASCII.
+ *
+ * The case tables are Peter Samson's, from hc_binmaker/src/ascii2fiodec.c:
+ * Copyright 2006 Peter Samson.  All Rights Reserved.
+ *
+ * The rest, MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HCFIODEC_H
+#define HCFIODEC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HC_FIODEC_SIMD
+#include <immintrin.h>
+#endif
+
+#define HC_FIODEC_CODES     0100    // codes per case
+#define HC_FIODEC_TO_LOWER  0272    // case shift frames, with parity
+#define HC_FIODEC_TO_UPPER  0274
+#define HC_FIODEC_NEWLINE   0277    // carriage return
+#define HC_FIODEC_STOP      013     // punched after the text, the compiler's end of input
+
+// ASCII for each FIODEC code, 0 where unassigned
+static const int HC_FIODEC_UPPER[HC_FIODEC_CODES] = {
+    ' ', '"', '\'', '{', '}', '|', '&', '<',
+    '>', '!', 0, '@', 0, 0, 0, 0,
+    ':', '?', 'S', 'T', 'U', 'V', 'W', 'X',
+    'Y', 'Z', 0, '=', 0, 0, '\t', 0,
+    '_', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 0, 0, '+', ']', '%', '[',
+    0, 'A', 'B', 'C', 'D', 'E', 'F', 'G',
+    'H', 'I', 0, '#', 0, '\b', 0, 0
+};
+static const int HC_FIODEC_LOWER[HC_FIODEC_CODES] = {
+    ' ', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', 0, '@', 0, 0, 0, 0,
+    '0', '/', 's', 't', 'u', 'v', 'w', 'x',
+    'y', 'z', 0, ',', 0, 0, '\t', 0,
+    ';', 'j', 'k', 'l', 'm', 'n', 'o', 'p',
+    'q', 'r', 0, 0, '-', ')', '~', '(',
+    0, 'a', 'b', 'c', 'd', 'e', 'f', 'g',
+    'h', 'i', 0, '.', 0, '\b', 0, 0
+};
+
+// encode classes: which case a character's code must be punched in
+#define HC_FIODEC_DROP      0       // no FIODEC code, the character is ignored
+#define HC_FIODEC_EITHER    1       // the same code in either case
+#define HC_FIODEC_IN_LOWER  2
+#define HC_FIODEC_IN_UPPER  3
+
+// decode table values that aren't characters
+#define HC_FIODEC_SKIP      0       // bad parity, channel 7 or an unassigned code
+#define HC_FIODEC_LOWERED   (-1)    // lower case shift
+#define HC_FIODEC_UPPERED   (-2)    // upper case shift
+
+typedef struct {
+    uint8_t code[256];              // FIODEC code with parity, per ASCII byte
+    uint8_t cls[256];               // encode class, per ASCII byte
+    int16_t decode[2][256];         // ASCII byte or decode value, per case (upper is 1) and frame
+    uint8_t vector[0200];           // 6-bit code | class << 6, for the vector encoders' lookup
+} hc_fiodec_tables_t;
+
+static hc_fiodec_tables_t hc_fiodec;
+
+// the code with its parity hole, so every frame has an odd number of holes
+static inline int hc_fiodec_parity(int code) {
+    int holes = 0;
+    for (int v = code; v; v >>= 1) holes += v & 1;
+    return (holes & 1) ? code : code + 0200;
+}
+
+static inline void hc_fiodec_set(int ch, int code, int cls) {
+    if (hc_fiodec.cls[ch] != HC_FIODEC_DROP) return;    // first match wins, as the original linear search did
+    hc_fiodec.code[ch] = (uint8_t)hc_fiodec_parity(code);
+    hc_fiodec.cls[ch] = (uint8_t)cls;
+    if (ch < 0200) hc_fiodec.vector[ch] = (uint8_t)(code | cls << 6);
+}
+
+static inline void hc_fiodec_init(void) {
+    memset(&hc_fiodec, 0, sizeof(hc_fiodec));
+
+    // these three are punched without a case shift
+    hc_fiodec_set(' ', 000, HC_FIODEC_EITHER);
+    hc_fiodec_set('\t', 036, HC_FIODEC_EITHER);
+    hc_fiodec_set('\n', 077, HC_FIODEC_EITHER);
+    for (int i = 0; i < HC_FIODEC_CODES; i++) {
+        if (HC_FIODEC_UPPER[i]) hc_fiodec_set(HC_FIODEC_UPPER[i], i, HC_FIODEC_IN_UPPER);
+        if (HC_FIODEC_LOWER[i]) hc_fiodec_set(HC_FIODEC_LOWER[i], i, HC_FIODEC_IN_LOWER);
+    }
+    // the original linear search matched NUL to the first unassigned code, upper case 012
+    hc_fiodec_set(0, 012, HC_FIODEC_IN_UPPER);
+
+    for (int uc = 0; uc < 2; uc++) {
+        for (int c = 0; c < 256; c++) {
+            int16_t *d = &hc_fiodec.decode[uc][c];
+            if (c == HC_FIODEC_TO_LOWER) *d = HC_FIODEC_LOWERED;
+            else if (c == HC_FIODEC_TO_UPPER) *d = HC_FIODEC_UPPERED;
+            else if (c == HC_FIODEC_NEWLINE) *d = '\n';
+            else if (hc_fiodec_parity(c) != c || (c & 0100)) *d = HC_FIODEC_SKIP;
+            else *d = (int16_t)(uc ? HC_FIODEC_UPPER[c & 077] : HC_FIODEC_LOWER[c & 077]);
+        }
+    }
+}
+
+/*
+ * An encoder appends the FIODEC for n ASCII bytes at out + *length, which needs room for 2n more bytes (a case shift
+ * before every character at most), advances *length, and returns the case it leaves the typewriter in (upper is 1).
+ * hc_fiodec_init() has to have run.
+ */
+typedef int hc_fiodec_encoder_t(const uint8_t *in, size_t n, int uc, uint8_t *out, size_t *length);
+
+static inline int hc_fiodec_encode_scalar(const uint8_t *in, size_t n, int uc, uint8_t *out, size_t *length) {
+    size_t o = *length;
+
+    for (size_t i = 0; i < n; i++) {
+        int c = in[i];
+        switch (hc_fiodec.cls[c]) {
+            case HC_FIODEC_DROP:
+                continue;
+            case HC_FIODEC_IN_LOWER:
+                if (uc) {
+                    out[o++] = HC_FIODEC_TO_LOWER;
+                    uc = 0;
+                }
+                break;
+            case HC_FIODEC_IN_UPPER:
+                if (!uc) {
+                    out[o++] = HC_FIODEC_TO_UPPER;
+                    uc = 1;
+                }
+                break;
+        }
+        out[o++] = hc_fiodec.code[c];
+    }
+
+    *length = o;
+    return uc;
+}
+
+#ifdef HC_FIODEC_SIMD
+// copies width looked-up codes to out, punching a case shift before each character whose bit is set in the other
+// case's mask
+static inline int hc_fiodec_run(const uint8_t *code, int width, unsigned up, unsigned lo, int uc, uint8_t *out,
+                                size_t *length) {
+    size_t o = *length;
+
+    for (int pos = 0; pos < width;) {
+        unsigned opposite = (uc ? lo : up) >> pos;
+        int k = opposite ? __builtin_ctz(opposite) : width - pos;
+        memcpy(out + o, code + pos, k);
+        o += k;
+        pos += k;
+        if (pos < width) {
+            out[o++] = uc ? HC_FIODEC_TO_LOWER : HC_FIODEC_TO_UPPER;
+            uc = !uc;
+        }
+    }
+
+    *length = o;
+    return uc;
+}
+
+/*
+ * The 0200-entry vector table is split into eight 16-byte rows, one per high nibble; each row is looked up with pshufb
+ * on the low nibble and the row matching the high nibble is kept. Odd parity comes from a nibble popcount.
+ */
+__attribute__((target("sse4.1")))
+static inline int hc_fiodec_encode_sse41(const uint8_t *in, size_t n, int uc, uint8_t *out, size_t *length) {
+    __m128i row[8];
+    uint8_t codes[16];
+    size_t i;
+
+    for (int h = 0; h < 8; h++) row[h] = _mm_loadu_si128((const __m128i *)(hc_fiodec.vector + 16 * h));
+    __m128i pop = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m128i nib = _mm_set1_epi8(017);
+    __m128i one = _mm_set1_epi8(1);
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        if (_mm_movemask_epi8(v)) {
+            uc = hc_fiodec_encode_scalar(in + i, 16, uc, out, length);
+            continue;
+        }
+        __m128i lo = _mm_and_si128(v, nib);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nib);
+        __m128i r = _mm_setzero_si128();
+        for (int h = 0; h < 8; h++) {
+            r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi8(hi, _mm_set1_epi8(h)), _mm_shuffle_epi8(row[h], lo)));
+        }
+        __m128i cls = _mm_and_si128(_mm_srli_epi16(r, 6), _mm_set1_epi8(3));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(cls, _mm_set1_epi8(HC_FIODEC_DROP)))) {
+            uc = hc_fiodec_encode_scalar(in + i, 16, uc, out, length);
+            continue;
+        }
+        __m128i code = _mm_and_si128(r, _mm_set1_epi8(077));
+        __m128i pc = _mm_add_epi8(_mm_shuffle_epi8(pop, _mm_and_si128(code, nib)),
+            _mm_shuffle_epi8(pop, _mm_and_si128(_mm_srli_epi16(code, 4), nib)));
+        code = _mm_or_si128(code, _mm_slli_epi16(_mm_andnot_si128(pc, one), 7));
+        _mm_storeu_si128((__m128i *)codes, code);
+        uc = hc_fiodec_run(codes, 16,
+            (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(cls, _mm_set1_epi8(HC_FIODEC_IN_UPPER))),
+            (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(cls, _mm_set1_epi8(HC_FIODEC_IN_LOWER))), uc, out, length);
+    }
+
+    return hc_fiodec_encode_scalar(in + i, n - i, uc, out, length);
+}
+
+__attribute__((target("avx2")))
+static inline int hc_fiodec_encode_avx2(const uint8_t *in, size_t n, int uc, uint8_t *out, size_t *length) {
+    __m256i row[8];
+    uint8_t codes[32];
+    size_t i;
+
+    for (int h = 0; h < 8; h++) {
+        row[h] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(hc_fiodec.vector + 16 * h)));
+    }
+    __m256i pop = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+    __m256i nib = _mm256_set1_epi8(017);
+    __m256i one = _mm256_set1_epi8(1);
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+        if (_mm256_movemask_epi8(v)) {
+            uc = hc_fiodec_encode_scalar(in + i, 32, uc, out, length);
+            continue;
+        }
+        __m256i lo = _mm256_and_si256(v, nib);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nib);
+        __m256i r = _mm256_setzero_si256();
+        for (int h = 0; h < 8; h++) {
+            r = _mm256_or_si256(r, _mm256_and_si256(_mm256_cmpeq_epi8(hi, _mm256_set1_epi8(h)),
+                _mm256_shuffle_epi8(row[h], lo)));
+        }
+        __m256i cls = _mm256_and_si256(_mm256_srli_epi16(r, 6), _mm256_set1_epi8(3));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(cls, _mm256_set1_epi8(HC_FIODEC_DROP)))) {
+            uc = hc_fiodec_encode_scalar(in + i, 32, uc, out, length);
+            continue;
+        }
+        __m256i code = _mm256_and_si256(r, _mm256_set1_epi8(077));
+        __m256i pc = _mm256_add_epi8(_mm256_shuffle_epi8(pop, _mm256_and_si256(code, nib)),
+            _mm256_shuffle_epi8(pop, _mm256_and_si256(_mm256_srli_epi16(code, 4), nib)));
+        code = _mm256_or_si256(code, _mm256_slli_epi16(_mm256_andnot_si256(pc, one), 7));
+        _mm256_storeu_si256((__m256i *)codes, code);
+        uc = hc_fiodec_run(codes, 32,
+            (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cls, _mm256_set1_epi8(HC_FIODEC_IN_UPPER))),
+            (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cls, _mm256_set1_epi8(HC_FIODEC_IN_LOWER))), uc, out,
+            length);
+    }
+
+    return hc_fiodec_encode_sse41(in + i, n - i, uc, out, length);
+}
+#endif
+
+// the fastest encoder this CPU runs, or the scalar one when asked
+static inline hc_fiodec_encoder_t *hc_fiodec_encoder(int scalar) {
+#ifdef HC_FIODEC_SIMD
+    if (!scalar) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return hc_fiodec_encode_avx2;
+        if (__builtin_cpu_supports("sse4.1")) return hc_fiodec_encode_sse41;
+    }
+#else
+    (void)scalar;
+#endif
+    return hc_fiodec_encode_scalar;
+}
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * hcnote.h
+ *
+ * The Harmony Compiler note word, written down in one place. Each field is a shift and a width, every decoder and
+ * encoder is built from those, and the note length, pitch name/octave and articulation name lookups are tables
+ * generated from the same macros when the tool is compiled, so decoding a note is a handful of shifts and loads with
+ * no division or branches. The _Static_asserts at the bottom check every field value round-trips through a word.
+ *
+ *   bits 17-16  articulation bits 3-2
+ *   bit  15     triplet
+ *   bits 14-13  articulation bits 1-0
+ *   bits 12-7   pitch
+ *   bits 6-0    duration
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HCNOTE_H
+#define HCNOTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HC_TICKS_PER_WHOLE 192      // note durations are duration * (triplet ? 2 : 3) ticks
+
+// fields as (shift, width), the articulation is split around the triplet bit
+#define HC_FIELD_DURATION   0, 7
+#define HC_FIELD_PITCH      7, 6
+#define HC_FIELD_ART_LOW    13, 2
+#define HC_FIELD_TRIPLET    15, 1
+#define HC_FIELD_ART_HIGH   16, 2
+
+#define HC_FIELD_MASK_(shift, width)        ((1u << (width)) - 1)
+#define HC_FIELD_GET_(word, shift, width)   (((uint32_t)(word) >> (shift)) & HC_FIELD_MASK_(shift, width))
+#define HC_FIELD_PUT_(value, shift, width)  (((uint32_t)(value) & HC_FIELD_MASK_(shift, width)) << (shift))
+#define HC_FIELD_GET(word, field)           HC_FIELD_GET_EXPAND_(word, field)
+#define HC_FIELD_PUT(value, field)          HC_FIELD_PUT_EXPAND_(value, field)
+#define HC_FIELD_GET_EXPAND_(word, ...)     HC_FIELD_GET_(word, __VA_ARGS__)
+#define HC_FIELD_PUT_EXPAND_(value, ...)    HC_FIELD_PUT_(value, __VA_ARGS__)
+
+#define HC_NOTE_DURATION(word)      HC_FIELD_GET(word, HC_FIELD_DURATION)
+#define HC_NOTE_PITCH(word)         HC_FIELD_GET(word, HC_FIELD_PITCH)
+#define HC_NOTE_TRIPLET(word)       HC_FIELD_GET(word, HC_FIELD_TRIPLET)
+#define HC_NOTE_ARTICULATION(word)  (HC_FIELD_GET(word, HC_FIELD_ART_HIGH) << 2 | HC_FIELD_GET(word, HC_FIELD_ART_LOW))
+
+#define HC_NOTE_WORD(articulation, triplet, pitch, duration) \
+    (HC_FIELD_PUT((uint32_t)(articulation) >> 2, HC_FIELD_ART_HIGH) | HC_FIELD_PUT(articulation, HC_FIELD_ART_LOW) | \
+     HC_FIELD_PUT(triplet, HC_FIELD_TRIPLET) | HC_FIELD_PUT(pitch, HC_FIELD_PITCH) | HC_FIELD_PUT(duration, HC_FIELD_DURATION))
+
+// ticks a note lasts, and its length as the 1/n of a whole note the compiler source writes (0 for duration 0)
+#define HC_NOTE_TICKS(triplet, duration)    ((duration) * ((triplet) ? 2 : 3))
+#define HC_NOTE_LENGTH(triplet, duration) \
+    ((duration) ? HC_TICKS_PER_WHOLE / HC_NOTE_TICKS(triplet, duration) : 0)
+
+// the note length table is indexed by the triplet bit and duration together
+#define HC_NOTE_LENGTH_INDEX(word)  (HC_NOTE_TRIPLET(word) << 7 | HC_NOTE_DURATION(word))
+
+// pitches 0 and 1 are rests, 2 is C1
+#define HC_REST_PITCHES 2
+#define HC_REST_NAME_INDEX 12
+
+// TODO: support minor keys too
+static const char *const HC_NOTE_NAMES[] = {
+    "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B", "r"
+};
+
+// the compiler punches articulations 0, 1, 2, 4 and 8, everything else has no name
+static const char *const HC_ARTICULATION_NAMES[16] = {
+    [0] = "normal", [1] = "quarter", [2] = "half", [4] = "staccato", [8] = "legato"
+};
+
+// repeats m(i) for n consecutive values of i, for building tables
+#define HC_REPEAT2_(m, i)   m(i) m((i) + 1)
+#define HC_REPEAT4_(m, i)   HC_REPEAT2_(m, i) HC_REPEAT2_(m, (i) + 2)
+#define HC_REPEAT8_(m, i)   HC_REPEAT4_(m, i) HC_REPEAT4_(m, (i) + 4)
+#define HC_REPEAT16_(m, i)  HC_REPEAT8_(m, i) HC_REPEAT8_(m, (i) + 8)
+#define HC_REPEAT32_(m, i)  HC_REPEAT16_(m, i) HC_REPEAT16_(m, (i) + 16)
+#define HC_REPEAT64_(m, i)  HC_REPEAT32_(m, i) HC_REPEAT32_(m, (i) + 32)
+#define HC_REPEAT128_(m, i) HC_REPEAT64_(m, i) HC_REPEAT64_(m, (i) + 64)
+#define HC_REPEAT256_(m, i) HC_REPEAT128_(m, i) HC_REPEAT128_(m, (i) + 128)
+
+#define HC_LENGTH_ENTRY_(i) HC_NOTE_LENGTH((i) >> 7, (i) & 0177),
+static const uint8_t HC_NOTE_LENGTHS[256] = { HC_REPEAT256_(HC_LENGTH_ENTRY_, 0) };
+
+typedef struct {
+    uint8_t note_pitch;     // above the rests, where 0 is C1
+    uint8_t octave;         // 0 for rests
+    uint8_t semi_tone;
+    uint8_t name;           // index into HC_NOTE_NAMES
+} hc_pitch_t;
+
+#define HC_IS_NOTE_(p) ((p) >= HC_REST_PITCHES)
+#define HC_PITCH_ENTRY_(p) { \
+    HC_IS_NOTE_(p) ? (p) - HC_REST_PITCHES : 0, \
+    HC_IS_NOTE_(p) ? ((p) - HC_REST_PITCHES) / 12 + 1 : 0, \
+    HC_IS_NOTE_(p) ? ((p) - HC_REST_PITCHES) % 12 : 0, \
+    HC_IS_NOTE_(p) ? ((p) - HC_REST_PITCHES) % 12 : HC_REST_NAME_INDEX },
+static const hc_pitch_t HC_PITCHES[64] = { HC_REPEAT64_(HC_PITCH_ENTRY_, 0) };
+
+typedef struct {
+    uint8_t articulation;
+    uint8_t triplet;
+    uint8_t pitch;
+    uint8_t duration;
+    uint8_t note_duration;
+    uint8_t note_pitch;
+    uint8_t octave;
+    uint8_t semi_tone;
+    const char *note_name;
+} hc_note_t;
+
+static inline void hc_parse_note(uint32_t word, hc_note_t *note) {
+    const hc_pitch_t *pitch = &HC_PITCHES[HC_NOTE_PITCH(word)];
+
+    note->articulation = HC_NOTE_ARTICULATION(word);
+    note->triplet = HC_NOTE_TRIPLET(word);
+    note->pitch = HC_NOTE_PITCH(word);
+    note->duration = HC_NOTE_DURATION(word);
+    note->note_duration = HC_NOTE_LENGTHS[HC_NOTE_LENGTH_INDEX(word)];
+    note->note_pitch = pitch->note_pitch;
+    note->octave = pitch->octave;
+    note->semi_tone = pitch->semi_tone;
+    note->note_name = HC_NOTE_NAMES[pitch->name];
+}
+
+static inline void hc_decode_notes(const uint32_t *words, size_t count, hc_note_t *notes) {
+    for (size_t i = 0; i < count; i++) {
+        hc_parse_note(words[i], &notes[i]);
+    }
+}
+
+// only the four fields are encoded, the rest of the note is derived from them
+static inline uint32_t hc_encode_note(const hc_note_t *note) {
+    return HC_NOTE_WORD(note->articulation, note->triplet, note->pitch, note->duration);
+}
+
+// returns NULL for articulation values the compiler never punches
+static inline const char *hc_articulation_name(uint32_t articulation) {
+    return HC_ARTICULATION_NAMES[articulation & 017];
+}
+
+// the fields cover the whole word without overlapping
+_Static_assert((HC_NOTE_WORD(017, 0, 0, 0) | HC_NOTE_WORD(0, 1, 0, 0) | HC_NOTE_WORD(0, 0, 077, 0) |
+                HC_NOTE_WORD(0, 0, 0, 0177)) == 0777777, "note fields don't cover the word");
+_Static_assert(HC_NOTE_WORD(017, 0, 0, 0) + HC_NOTE_WORD(0, 1, 0, 0) + HC_NOTE_WORD(0, 0, 077, 0) +
+               HC_NOTE_WORD(0, 0, 0, 0177) == 0777777, "note fields overlap");
+
+// every value of each field comes back out of a word, with the other fields all ones or all zeros around it
+#define HC_ROUND_TRIP_DURATION_(d) \
+    && HC_NOTE_DURATION(HC_NOTE_WORD(0, 0, 0, d)) == (d) && HC_NOTE_WORD(0, 0, 0, d) == (d) \
+    && HC_NOTE_DURATION(HC_NOTE_WORD(017, 1, 077, d)) == (d) && HC_NOTE_PITCH(HC_NOTE_WORD(017, 1, 077, d)) == 077
+#define HC_ROUND_TRIP_PITCH_(p) \
+    && HC_NOTE_PITCH(HC_NOTE_WORD(0, 0, p, 0)) == (p) && HC_NOTE_DURATION(HC_NOTE_WORD(0, 0, p, 0)) == 0 \
+    && HC_NOTE_PITCH(HC_NOTE_WORD(017, 1, p, 0177)) == (p) && HC_NOTE_DURATION(HC_NOTE_WORD(017, 1, p, 0177)) == 0177
+#define HC_ROUND_TRIP_ARTICULATION_(a) \
+    && HC_NOTE_ARTICULATION(HC_NOTE_WORD(a, 0, 0, 0)) == (a) && HC_NOTE_TRIPLET(HC_NOTE_WORD(a, 0, 0, 0)) == 0 \
+    && HC_NOTE_ARTICULATION(HC_NOTE_WORD(a, 1, 077, 0177)) == (a) && HC_NOTE_TRIPLET(HC_NOTE_WORD(a, 1, 077, 0177)) == 1
+_Static_assert(1 HC_REPEAT128_(HC_ROUND_TRIP_DURATION_, 0), "duration doesn't round-trip");
+_Static_assert(1 HC_REPEAT64_(HC_ROUND_TRIP_PITCH_, 0), "pitch doesn't round-trip");
+_Static_assert(1 HC_REPEAT16_(HC_ROUND_TRIP_ARTICULATION_, 0), "articulation doesn't round-trip");
+_Static_assert(HC_NOTE_TRIPLET(HC_NOTE_WORD(0, 1, 0, 0)) == 1 && HC_NOTE_TRIPLET(HC_NOTE_WORD(017, 0, 077, 0177)) == 0,
+               "triplet doesn't round-trip");
+
+// the tables agree with the lengths the compiler source writes
+_Static_assert(HC_NOTE_LENGTH(0, 48) == 1 && HC_NOTE_LENGTH(0, 16) == 4 && HC_NOTE_LENGTH(1, 24) == 4 &&
+               HC_NOTE_LENGTH(1, 4) == 24 && HC_NOTE_LENGTH(0, 0) == 0, "note lengths");
+_Static_assert(sizeof(HC_NOTE_NAMES) / sizeof(*HC_NOTE_NAMES) == HC_REST_NAME_INDEX + 1, "rest name index");
+
+#endif
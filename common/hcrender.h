@@ -0,0 +1,167 @@
+/*
+ * hcrender.h
+ *
+ * The preview renderer's audio, shared by render and pitchcheck so a check hears exactly what render writes: how long
+ * each articulation sounds, a voice's length and its square wave on the event timeline, and the 16-bit stereo WAV
+ * writer.
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HCRENDER_H
+#define HCRENDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hctape.h"
+
+#define HC_DEFAULT_SAMPLE_RATE 44100
+#define HC_RENDER_VOLUME 0.25
+#define HC_READ_BLOCK 65536
+
+typedef struct {
+    const char *out_path;   // WAV file, for the tools that write one
+    uint32_t sample_rate;
+    double speed;           // 1.0 for a PDP-1 at spec, CHM_PDP1_CPU_SPEED_MULTIPLIER for the CHM machine
+    uint32_t tempo;         // raw tempo override, 0 to use the tape's
+} hc_render_options_t;
+
+// fraction of a note's length that it sounds for, by articulation
+static inline double hc_sounding_fraction(uint32_t articulation) {
+    switch (articulation) {
+        case 1: return 0.25;    // quarter
+        case 2: return 0.5;     // half
+        case 4: return 0.125;   // staccato
+        case 8: return 1.0;     // legato
+        default: return 0.875;  // normal, with a short release between notes
+    }
+}
+
+// reads a whole file (or stdin) into memory, NULL when out of memory
+static inline uint8_t *hc_read_all(FILE *fp, size_t *length) {
+    size_t capacity = HC_READ_BLOCK;
+    uint8_t *data = malloc(capacity);
+    size_t n;
+
+    *length = 0;
+    while (data && (n = fread(data + *length, 1, capacity - *length, fp)) > 0) {
+        *length += n;
+        if (*length == capacity) {
+            capacity *= 2;
+            uint8_t *grown = realloc(data, capacity);
+            if (!grown) free(data);
+            data = grown;
+        }
+    }
+
+    return data;
+}
+
+// seconds of a voice's events at the given speed
+static inline double hc_voice_seconds(const hc_event_t *events, long count, const hc_render_options_t *opts) {
+    double seconds = 0;
+
+    for (long i = 0; i < count; i++) {
+        seconds += events[i].ticks * hc_tick_seconds(opts->tempo ? opts->tempo : events[i].tempo);
+    }
+
+    return seconds / opts->speed;
+}
+
+// adds a voice's square wave into a mono buffer of frames samples
+static inline void hc_render_voice(const hc_event_t *events, long count, const hc_render_options_t *opts, float *out, size_t frames) {
+    double time = 0;
+    double phase = 0;
+
+    for (long i = 0; i < count; i++) {
+        const hc_event_t *e = &events[i];
+        double length = e->ticks * hc_tick_seconds(opts->tempo ? opts->tempo : e->tempo) / opts->speed;
+        size_t start = (size_t)(time * opts->sample_rate + 0.5);
+        size_t end = (size_t)((time + length * hc_sounding_fraction(e->articulation)) * opts->sample_rate + 0.5);
+        time += length;
+
+        if (e->pitch < 2) continue;
+        if (end > frames) end = frames;
+
+        // the phase carries over between notes, the way the player's flip-flop keeps its state
+        double step = hc_pitch_frequency(e->pitch) * opts->speed / opts->sample_rate;
+        for (size_t s = start; s < end; s++) {
+            out[s] += phase < 0.5 ? HC_RENDER_VOLUME : -HC_RENDER_VOLUME;
+            phase += step;
+            if (phase >= 1.0) phase -= 1.0;
+        }
+    }
+}
+
+static inline void hc_put_u16(FILE *fp, uint16_t v) {
+    putc(v & 0xff, fp);
+    putc(v >> 8, fp);
+}
+
+static inline void hc_put_u32(FILE *fp, uint32_t v) {
+    hc_put_u16(fp, v & 0xffff);
+    hc_put_u16(fp, v >> 16);
+}
+
+// writes a 16-bit stereo WAV, clipping the mix to full scale
+static inline int hc_write_wav(FILE *fp, const float *left, const float *right, size_t frames, uint32_t sample_rate) {
+    uint32_t data_bytes = (uint32_t)(frames * 4);
+
+    fwrite("RIFF", 1, 4, fp);
+    hc_put_u32(fp, 36 + data_bytes);
+    fwrite("WAVEfmt ", 1, 8, fp);
+    hc_put_u32(fp, 16);
+    hc_put_u16(fp, 1);                 // PCM
+    hc_put_u16(fp, 2);                 // stereo
+    hc_put_u32(fp, sample_rate);
+    hc_put_u32(fp, sample_rate * 4);   // byte rate
+    hc_put_u16(fp, 4);                 // block align
+    hc_put_u16(fp, 16);                // bits per sample
+    fwrite("data", 1, 4, fp);
+    hc_put_u32(fp, data_bytes);
+
+    // samples go out little-endian a block at a time, putc() per byte is most of the runtime otherwise
+    uint8_t block[4096];
+    size_t used = 0;
+    for (size_t i = 0; i < frames; i++) {
+        float l = left[i] > 1.0f ? 1.0f : left[i] < -1.0f ? -1.0f : left[i];
+        float r = right[i] > 1.0f ? 1.0f : right[i] < -1.0f ? -1.0f : right[i];
+        uint16_t ls = (uint16_t)(int16_t)(l * 32767);
+        uint16_t rs = (uint16_t)(int16_t)(r * 32767);
+        block[used++] = ls & 0xff;
+        block[used++] = ls >> 8;
+        block[used++] = rs & 0xff;
+        block[used++] = rs >> 8;
+        if (used == sizeof(block)) {
+            fwrite(block, 1, used, fp);
+            used = 0;
+        }
+    }
+    fwrite(block, 1, used, fp);
+
+    return ferror(fp) ? -1 : 0;
+}
+
+#endif
@@ -0,0 +1,337 @@
+/*
+ * hcsalvage.h
+ *
+ * Recovers the intact parts of a damaged intermediate tape image. Rather than reading the tape front to back and
+ * giving up at the first bad frame, it looks for every run of blank frames (16 frames at a time with SSE2), treats
+ * the first binary frame after each as a possible part start, and keeps a candidate when its word count leads to a
+ * checksum that matches. A part that fails is tried again skipping blank frames inside words (a stray blank frame,
+ * which rpb reads through), then reading every frame as data (frames that lost the 8th hole). Whatever binary
+ * frames are left between the intact parts are reported as damaged spans, and notes parts directly followed by a bars
+ * part that indexes into them are paired into voices.
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HCSALVAGE_H
+#define HCSALVAGE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hctape.h"
+
+// blank frames before a candidate part start, half the compiler's shortest gap so a damaged gap still counts
+#define HC_SALVAGE_MIN_GAP (HC_INNER_GAP_FRAMES / 2)
+
+// how a candidate part's frames are read, each tried in turn
+typedef enum {
+    HC_SALVAGE_STRICT,          // as decodehcint, no blank frames inside words
+    HC_SALVAGE_SKIP_BLANKS,     // blank frames inside words skipped, as rpb does
+    HC_SALVAGE_ALL_DATA         // every frame is data, blank or not
+} hc_salvage_mode_t;
+
+typedef enum {
+    HC_SALVAGE_PART,            // intact, but not paired into a voice
+    HC_SALVAGE_NOTES,
+    HC_SALVAGE_BARS
+} hc_salvage_kind_t;
+
+typedef struct {
+    size_t offset;              // the word count's first frame
+    size_t end;                 // one past the checksum's last frame
+    uint32_t count;             // data words
+    uint32_t *words;
+    uint32_t checksum;
+    uint32_t repaired;          // blank frames inside words that were skipped or read as data
+    hc_salvage_kind_t kind;
+    uint32_t voice;             // 1-based in the order recovered for paired notes and bars parts, 0 otherwise
+} hc_salvage_part_t;
+
+typedef struct {
+    size_t start;
+    size_t end;
+    size_t binary_frames;       // frames with the 8th hole that aren't in an intact part
+} hc_salvage_damage_t;
+
+typedef struct {
+    uint32_t min_gap;
+    hc_salvage_part_t *parts;
+    size_t parts_count;
+    size_t parts_capacity;
+    hc_salvage_damage_t *damage;
+    size_t damage_count;
+    size_t damage_capacity;
+    uint32_t voices;
+    uint32_t *scratch;          // a candidate's words, copied out once it checks
+    size_t scratch_capacity;
+} hc_salvage_t;
+
+static inline void hc_salvage_init(hc_salvage_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->min_gap = HC_SALVAGE_MIN_GAP;
+}
+
+static inline void hc_salvage_free(hc_salvage_t *s) {
+    for (size_t i = 0; i < s->parts_count; i++) free(s->parts[i].words);
+    free(s->parts);
+    free(s->damage);
+    free(s->scratch);
+    s->parts = NULL;
+    s->damage = NULL;
+    s->scratch = NULL;
+    s->parts_count = s->parts_capacity = s->damage_count = s->damage_capacity = s->scratch_capacity = 0;
+    s->voices = 0;
+}
+
+/*
+ * Returns the offset of the first binary frame at or after pos that follows at least min_gap blank frames, counting
+ * run blank frames already seen just before pos, or length if there isn't one. The 8th hole is the sign bit, so
+ * movemask gives 16 frames' worth of binary/blank at once, and whole chunks of data or gap are skipped without
+ * looking at each frame.
+ */
+static inline size_t hc_salvage_next_start(const uint8_t *tape, size_t length, size_t pos, size_t run,
+                                           uint32_t min_gap) {
+#ifdef __SSE2__
+    for (; pos + 16 <= length; pos += 16) {
+        uint32_t binary = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(tape + pos)));
+
+        if (!binary) {
+            run += 16;
+            continue;
+        }
+        if (binary == 0xffff && run < min_gap) {
+            run = 0;
+            continue;
+        }
+        for (uint32_t i = 0; i < 16; i++) {
+            if (binary & (1u << i)) {
+                if (run >= min_gap) return pos + i;
+                run = 0;
+            } else {
+                run++;
+            }
+        }
+    }
+#endif
+
+    for (; pos < length; pos++) {
+        if (tape[pos] & 0200) {
+            if (run >= min_gap) return pos;
+            run = 0;
+        } else {
+            run++;
+        }
+    }
+
+    return length;
+}
+
+// frames with the 8th hole in [start, end)
+static inline size_t hc_salvage_binary_frames(const uint8_t *tape, size_t start, size_t end) {
+    size_t frames = 0;
+
+    for (size_t i = start; i < end; i++) frames += tape[i] >> 7;
+    return frames;
+}
+
+// reads a word, skipping blank frames before it, and handling blank frames inside it as the mode says
+static inline int hc_salvage_word(const uint8_t *tape, size_t length, size_t *pos, hc_salvage_mode_t mode,
+                                  uint32_t *word, uint32_t *repaired) {
+    size_t p = *pos;
+    uint32_t w = 0;
+
+    if (mode != HC_SALVAGE_ALL_DATA) {
+        while (p < length && !(tape[p] & 0200)) p++;
+    }
+
+    for (int i = 0; i < 3; p++) {
+        if (p == length) return -1;
+        if (!(tape[p] & 0200) && mode != HC_SALVAGE_ALL_DATA) {
+            if (mode == HC_SALVAGE_STRICT) return -1;
+            (*repaired)++;
+            continue;
+        }
+        if (!(tape[p] & 0200)) (*repaired)++;
+        w = (w << 6) | (tape[p] & 077);
+        i++;
+    }
+
+    *word = w;
+    *pos = p;
+    return 0;
+}
+
+// checks the part starting at offset, leaving its words in s->scratch
+static inline int hc_salvage_check(hc_salvage_t *s, const uint8_t *tape, size_t length, size_t offset,
+                                   hc_salvage_mode_t mode, hc_salvage_part_t *part) {
+    size_t pos = offset;
+    uint32_t count;
+    uint32_t word;
+    uint32_t checksum = 0;
+    uint32_t repaired = 0;
+
+    if (hc_salvage_word(tape, length, &pos, mode, &count, &repaired) < 0) return -1;
+
+    // the compiler never punches an empty part, and a part can't hold more words than there are frames left
+    if (!count || (size_t)count + 1 > (length - pos) / 3) return -1;
+
+    if (count > s->scratch_capacity) {
+        uint32_t *grown = realloc(s->scratch, count * sizeof(uint32_t));
+        if (!grown) return -1;
+        s->scratch = grown;
+        s->scratch_capacity = count;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (hc_salvage_word(tape, length, &pos, mode, &word, &repaired) < 0) return -1;
+        s->scratch[i] = word;
+        checksum = hc_add_1s_complement(checksum, word);
+    }
+    if (hc_salvage_word(tape, length, &pos, mode, &word, &repaired) < 0 || word != checksum) return -1;
+
+    // more than a bad frame per word is a run of noise that happened to add up, not a damaged part
+    if (repaired > count) return -1;
+
+    memset(part, 0, sizeof(*part));
+    part->offset = offset;
+    part->end = pos;
+    part->count = count;
+    part->checksum = checksum;
+    part->repaired = repaired;
+    return 0;
+}
+
+static inline int hc_salvage_add_damage(hc_salvage_t *s, const uint8_t *tape, size_t start, size_t end) {
+    size_t binary = hc_salvage_binary_frames(tape, start, end);
+
+    if (!binary) return 0;
+    if (s->damage_count == s->damage_capacity) {
+        size_t capacity = s->damage_capacity ? s->damage_capacity * 2 : 16;
+        hc_salvage_damage_t *grown = realloc(s->damage, capacity * sizeof(hc_salvage_damage_t));
+        if (!grown) return -1;
+        s->damage = grown;
+        s->damage_capacity = capacity;
+    }
+
+    // trim the blank frames at either end, they're gap rather than damage
+    while (!(tape[start] & 0200)) start++;
+    while (!(tape[end - 1] & 0200)) end--;
+
+    hc_salvage_damage_t *d = &s->damage[s->damage_count++];
+    d->start = start;
+    d->end = end;
+    d->binary_frames = binary;
+    return 0;
+}
+
+static inline int hc_salvage_add_part(hc_salvage_t *s, const hc_salvage_part_t *part) {
+    if (s->parts_count == s->parts_capacity) {
+        size_t capacity = s->parts_capacity ? s->parts_capacity * 2 : 16;
+        hc_salvage_part_t *grown = realloc(s->parts, capacity * sizeof(hc_salvage_part_t));
+        if (!grown) return -1;
+        s->parts = grown;
+        s->parts_capacity = capacity;
+    }
+
+    hc_salvage_part_t *p = &s->parts[s->parts_count];
+    *p = *part;
+    p->words = malloc((part->count ? part->count : 1) * sizeof(uint32_t));
+    if (!p->words) return -1;
+    memcpy(p->words, s->scratch, part->count * sizeof(uint32_t));
+    s->parts_count++;
+    return 0;
+}
+
+// a bars part ends with the end of bars word and indexes only into the notes part before it, as decodehcint checks
+static inline int hc_salvage_is_bars_of(const hc_salvage_part_t *notes, const hc_salvage_part_t *bars) {
+    if (!bars->count || bars->words[bars->count - 1] != HC_END_OF_MEASURE) return 0;
+    for (uint32_t i = 0; i + 1 < bars->count; i++) {
+        if (bars->words[i] + 1 >= notes->count) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Scans a whole tape image in one pass, adding its intact parts, damaged spans and voices to s (which should be
+ * fresh from hc_salvage_init(), with min_gap set if the default doesn't suit). Returns -1 only when out of memory.
+ */
+static inline int hc_salvage_scan(hc_salvage_t *s, const uint8_t *tape, size_t length) {
+    hc_salvage_part_t part;
+    size_t covered = 0;         // end of the last intact part
+    size_t pos = 0;
+    size_t run = s->min_gap;    // the start of the tape counts as a gap
+    size_t start;
+
+    while ((start = hc_salvage_next_start(tape, length, pos, run, s->min_gap)) < length) {
+        if (hc_salvage_check(s, tape, length, start, HC_SALVAGE_STRICT, &part) == 0
+            || hc_salvage_check(s, tape, length, start, HC_SALVAGE_SKIP_BLANKS, &part) == 0
+            || hc_salvage_check(s, tape, length, start, HC_SALVAGE_ALL_DATA, &part) == 0) {
+            if (hc_salvage_add_damage(s, tape, covered, start) < 0 || hc_salvage_add_part(s, &part) < 0) return -1;
+            covered = pos = part.end;
+        } else {
+            pos = start + 1;
+        }
+        run = 0;
+    }
+    if (hc_salvage_add_damage(s, tape, covered, length) < 0) return -1;
+
+    // pair each notes part with the bars part right after it, when no damage came between them
+    size_t d = 0;
+    for (size_t i = 1; i < s->parts_count; i++) {
+        hc_salvage_part_t *notes = &s->parts[i - 1];
+        hc_salvage_part_t *bars = &s->parts[i];
+
+        while (d < s->damage_count && s->damage[d].end <= notes->end) d++;
+        if (notes->kind != HC_SALVAGE_PART || (d < s->damage_count && s->damage[d].start < bars->offset)) continue;
+        if (hc_salvage_is_bars_of(notes, bars)) {
+            notes->kind = HC_SALVAGE_NOTES;
+            bars->kind = HC_SALVAGE_BARS;
+            notes->voice = bars->voice = ++s->voices;
+        }
+    }
+
+    return 0;
+}
+
+// punches the paired voices as the compiler lays them out, each with its own leader and trailer
+static inline void hc_salvage_punch(const hc_salvage_t *s, FILE *fp) {
+    for (size_t i = 0; i < s->parts_count; i++) {
+        const hc_salvage_part_t *p = &s->parts[i];
+
+        if (p->kind == HC_SALVAGE_NOTES) {
+            hc_blank(fp, HC_LEADER_FRAMES);
+            hc_punch_part(fp, p->words, p->count);
+            hc_blank(fp, HC_INNER_GAP_FRAMES);
+        } else if (p->kind == HC_SALVAGE_BARS) {
+            hc_punch_part(fp, p->words, p->count);
+            hc_blank(fp, HC_TRAILER_FRAMES);
+        }
+    }
+}
+
+#endif
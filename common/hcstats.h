@@ -0,0 +1,189 @@
+/*
+ * hcstats.h
+ *
+ * Run metrics for the tape tools, written as one JSON document when a tool is given --stats (to stderr) or
+ * --stats=<file>. A tool bumps the counters as it reads and writes, and marks its phases; the time and the bytes in
+ * and out of each phase are taken between marks. The keys are the same for every tool and every run, zero or not,
+ * so dashboards can compare runs without knowing which tool made them.
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HCSTATS_H
+#define HCSTATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HC_STATS_VERSION 1
+#define HC_STATS_MAX_PHASES 16
+
+typedef struct {
+    uint64_t bytes_read;            // every byte in, tape frames or text
+    uint64_t bytes_written;
+    uint64_t frames_read;           // tape frames, blank ones included
+    uint64_t frames_written;
+    uint64_t words_read;            // 18-bit words assembled from 3 frames
+    uint64_t words_written;
+    uint64_t gap_frames;            // blank frames read between words
+    uint64_t checksum_ops;          // 1s complement additions
+} hc_counters_t;
+
+typedef struct {
+    const char *name;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    double seconds;
+} hc_phase_t;
+
+typedef struct {
+    const char *tool;
+    const char *path;               // NULL when --stats wasn't given
+    int complete;                   // set by the tool once it has done its job, an error exit leaves it 0
+    hc_counters_t counts;
+    hc_phase_t phases[HC_STATS_MAX_PHASES];
+    int phases_count;
+    int phase;                      // the open phase, -1 before the first
+    double phase_start;
+    hc_counters_t phase_counts;     // counters when the open phase began
+    double start;
+} hc_stats_t;
+
+static hc_stats_t hc_stats;
+
+// where HC_COUNT() adds, a worker thread points this at counters of its own and adds them in with hc_stats_add()
+static _Thread_local hc_counters_t *hc_counts = &hc_stats.counts;
+
+#define HC_COUNT(counter, n) (hc_counts->counter += (n))
+
+static inline void hc_stats_add(const hc_counters_t *c) {
+    hc_stats.counts.bytes_read += c->bytes_read;
+    hc_stats.counts.bytes_written += c->bytes_written;
+    hc_stats.counts.frames_read += c->frames_read;
+    hc_stats.counts.frames_written += c->frames_written;
+    hc_stats.counts.words_read += c->words_read;
+    hc_stats.counts.words_written += c->words_written;
+    hc_stats.counts.gap_frames += c->gap_frames;
+    hc_stats.counts.checksum_ops += c->checksum_ops;
+}
+
+static inline double hc_stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// closes the open phase, adding its time and bytes to it
+static inline void hc_stats_close_phase(void) {
+    if (hc_stats.phase < 0) return;
+
+    hc_phase_t *p = &hc_stats.phases[hc_stats.phase];
+    p->seconds += hc_stats_now() - hc_stats.phase_start;
+    p->bytes_in += hc_stats.counts.bytes_read - hc_stats.phase_counts.bytes_read;
+    p->bytes_out += hc_stats.counts.bytes_written - hc_stats.phase_counts.bytes_written;
+    hc_stats.phase = -1;
+}
+
+// starts a phase, a name used before adds to the same entry (so "notes" covers every voice's notes)
+static inline void hc_stats_phase(const char *name) {
+    int i;
+
+    hc_stats_close_phase();
+    for (i = 0; i < hc_stats.phases_count && strcmp(hc_stats.phases[i].name, name); i++);
+    if (i == hc_stats.phases_count) {
+        if (i == HC_STATS_MAX_PHASES) return;
+        hc_stats.phases[hc_stats.phases_count++].name = name;
+    }
+
+    hc_stats.phase = i;
+    hc_stats.phase_start = hc_stats_now();
+    hc_stats.phase_counts = hc_stats.counts;
+}
+
+static inline void hc_stats_write(FILE *fp) {
+    const hc_counters_t *c = &hc_stats.counts;
+
+    hc_stats_close_phase();
+    fprintf(fp, "{\n  \"tool\": \"%s\",\n  \"version\": %d,\n  \"complete\": %s,\n", hc_stats.tool, HC_STATS_VERSION,
+        hc_stats.complete ? "true" : "false");
+    fprintf(fp, "  \"elapsed_seconds\": %.6f,\n", hc_stats_now() - hc_stats.start);
+    fprintf(fp,
+        "  \"counters\": {\n"
+        "    \"bytes_read\": %llu,\n    \"bytes_written\": %llu,\n"
+        "    \"frames_read\": %llu,\n    \"frames_written\": %llu,\n"
+        "    \"words_read\": %llu,\n    \"words_written\": %llu,\n"
+        "    \"gap_frames\": %llu,\n    \"checksum_ops\": %llu\n  },\n",
+        (unsigned long long)c->bytes_read, (unsigned long long)c->bytes_written,
+        (unsigned long long)c->frames_read, (unsigned long long)c->frames_written,
+        (unsigned long long)c->words_read, (unsigned long long)c->words_written,
+        (unsigned long long)c->gap_frames, (unsigned long long)c->checksum_ops);
+    fprintf(fp, "  \"phases\": [");
+    for (int i = 0; i < hc_stats.phases_count; i++) {
+        const hc_phase_t *p = &hc_stats.phases[i];
+        fprintf(fp, "%s\n    { \"name\": \"%s\", \"seconds\": %.6f, \"bytes_in\": %llu, \"bytes_out\": %llu }",
+            i ? "," : "", p->name, p->seconds, (unsigned long long)p->bytes_in, (unsigned long long)p->bytes_out);
+    }
+    fprintf(fp, "%s]\n}\n", hc_stats.phases_count ? "\n  " : "");
+}
+
+// runs at exit, so the document is written on error exits too, with "complete": false
+static inline void hc_stats_at_exit(void) {
+    FILE *fp = strcmp(hc_stats.path, "-") ? fopen(hc_stats.path, "w") : stderr;
+
+    if (!fp) {
+        perror(hc_stats.path);
+        return;
+    }
+    hc_stats_write(fp);
+    if (fp != stderr) fclose(fp);
+}
+
+/*
+ * Starts the clock, and takes --stats or --stats=<file> out of argv so the tool's own argument handling never sees
+ * it. Call first thing in main().
+ */
+static inline void hc_stats_init(const char *tool, int *argc, char *argv[]) {
+    int kept = 1;
+
+    hc_stats.tool = tool;
+    hc_stats.phase = -1;
+    hc_stats.start = hc_stats_now();
+
+    for (int i = 1; i < *argc; i++) {
+        if (!strcmp(argv[i], "--stats")) {
+            hc_stats.path = "-";
+        } else if (!strncmp(argv[i], "--stats=", 8)) {
+            hc_stats.path = argv[i] + 8;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    *argc = kept;
+    argv[kept] = NULL;
+
+    if (hc_stats.path) atexit(hc_stats_at_exit);
+}
+
+#endif
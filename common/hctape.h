@@ -0,0 +1,381 @@
+/*
+ * hctape.h
+ *
+ * Shared helpers for reading and writing Harmony Compiler intermediate binary paper tape images.
+ * 
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HCTAPE_H
+#define HCTAPE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "hcnote.h"
+
+// On 2024-01-05 Peter Samson mentioned the CHM PDP-1 CPU runs 6% slower than spec
+#define CHM_PDP1_CPU_SPEED_MULTIPLIER 0.94
+
+#define HC_END_OF_MEASURE 0600000
+#define HC_TEMPO_MASK     0700000
+#define HC_DEFAULT_TEMPO  99        // raw tempo for a tape with no tempo word
+#define HC_C1_FREQUENCY   32.7032
+
+// blank frames the Harmony Compiler punches around each voice's notes and bars parts
+#define HC_LEADER_FRAMES    256
+#define HC_INNER_GAP_FRAMES 6
+#define HC_TRAILER_FRAMES   192
+
+// the tempo and end of measure words are the only ones with both high articulation bits set
+_Static_assert(HC_NOTE_ARTICULATION(HC_TEMPO_MASK) == 014 && HC_NOTE_ARTICULATION(HC_END_OF_MEASURE) == 014,
+               "control words");
+
+static inline uint32_t hc_decode_tempo_quarter(uint32_t tempo) {
+    // see decode_tempo_quarter() in verify/decodehcint.c for where 11436 comes from
+    return (tempo & 0077777) ? 11436 / (tempo & 0077777) : 0;
+}
+
+// seconds per tick at a raw tempo, from the same 11436 / tempo quarter note BPM
+static inline double hc_tick_seconds(uint32_t tempo) {
+    return (tempo & 0077777) * 240.0 / (11436.0 * HC_TICKS_PER_WHOLE);
+}
+
+// frequency of a pitch field value above the 2 rest pitches, on a PDP-1 running at spec
+static inline double hc_pitch_frequency(uint32_t pitch) {
+    return HC_C1_FREQUENCY * pow(2.0, ((double)pitch - 2.0) / 12.0);
+}
+
+static inline uint32_t hc_add_1s_complement(uint32_t a, uint32_t b) {
+    uint32_t sum = a + b;
+    // add the carry to the sum and mask off potential overflow
+    return ((sum & 0777777) + (sum >> 18)) & 0777777;
+}
+
+static inline void hc_ppb(FILE *fp, uint32_t word) {
+    putc(0200 | ((word & 0770000) >> 12), fp);
+    putc(0200 | ((word & 0007700) >> 6), fp);
+    putc(0200 | ((word & 0000077)), fp);
+}
+
+static inline void hc_blank(FILE *fp, uint32_t frames) {
+    while (frames--) putc(0, fp);
+}
+
+// punches a part as the compiler does: word count, data words, then their 1s complement checksum
+static inline void hc_punch_part(FILE *fp, const uint32_t *words, uint32_t count) {
+    uint32_t checksum = 0;
+
+    hc_ppb(fp, count);
+    for (uint32_t i = 0; i < count; i++) {
+        hc_ppb(fp, words[i]);
+        checksum = hc_add_1s_complement(checksum, words[i]);
+    }
+    hc_ppb(fp, checksum);
+}
+
+/*
+ * Frame to word assembly, one frame at a time, following the PDP-1 rpb instruction: frames without the 8th bit
+ * set are blank, the 7th bit is ignored, and three binary frames make an 18-bit word.
+ */
+typedef struct {
+    uint32_t word;
+    uint32_t frames;        // binary frames in the word so far (0..2)
+    uint32_t gap_frames;    // blank frames before the word's first binary frame
+    uint32_t inner_frames;  // blank frames between the word's binary frames
+} hc_framer_t;
+
+// returns 1 and fills *word when c completes a word, with the framer's gap/inner counts describing that word
+static inline int hc_framer_push(hc_framer_t *f, int c, uint32_t *word) {
+    if (!(c & 0200)) {
+        if (f->frames) {
+            f->inner_frames++;
+        } else {
+            f->gap_frames++;
+        }
+        return 0;
+    }
+
+    f->word = (f->word << 6) | (c & 077);
+    if (++f->frames < 3) return 0;
+
+    *word = f->word & 0777777;
+    return 1;
+}
+
+// call after a completed word has been consumed, to start counting the next one
+static inline void hc_framer_next(hc_framer_t *f) {
+    f->word = 0;
+    f->frames = 0;
+    f->gap_frames = 0;
+    f->inner_frames = 0;
+}
+
+/*
+ * Part structure. A tape is a sequence of parts separated by blank gaps, alternating notes and bars for each voice.
+ * Each part is a word count, that many data words, and a 1s complement checksum of the data words.
+ */
+typedef enum {
+    HC_PART_NOTES = 0,
+    HC_PART_BARS = 1,
+} hc_part_kind_t;
+
+typedef enum {
+    HC_WORD_COUNT,          // first word of a part
+    HC_WORD_DATA,           // note/tempo/end-of-measure word, or bar index
+    HC_WORD_CHECKSUM_GOOD,  // last word of a part
+    HC_WORD_CHECKSUM_BAD,
+} hc_word_kind_t;
+
+typedef struct {
+    int in_part;
+    uint32_t parts;         // parts started so far
+    hc_part_kind_t kind;    // kind of the current (or last) part
+    uint32_t voice;         // 1-based voice of the current (or last) part
+    uint32_t pos;           // word index within the part, 0 is the word count
+    uint32_t count;
+    uint32_t checksum;
+    uint32_t expected;      // checksum word, once read
+} hc_parts_t;
+
+static inline void hc_parts_init(hc_parts_t *p) {
+    p->in_part = 0;
+    p->parts = 0;
+    p->kind = HC_PART_NOTES;
+    p->voice = 1;
+    p->pos = 0;
+    p->count = 0;
+    p->checksum = 0;
+    p->expected = 0;
+}
+
+static inline hc_word_kind_t hc_parts_push(hc_parts_t *p, uint32_t word) {
+    if (!p->in_part) {
+        // notes and bars alternate, a new voice starts with every notes part
+        p->kind = (hc_part_kind_t)(p->parts & 1);
+        p->voice = p->parts / 2 + 1;
+        p->parts++;
+        p->in_part = 1;
+        p->pos = 0;
+        p->count = word;
+        p->checksum = 0;
+        return HC_WORD_COUNT;
+    }
+
+    p->pos++;
+    if (p->pos <= p->count) {
+        p->checksum = hc_add_1s_complement(p->checksum, word);
+        return HC_WORD_DATA;
+    }
+
+    // checksum word closes the part
+    p->in_part = 0;
+    p->expected = word;
+    return word == p->checksum ? HC_WORD_CHECKSUM_GOOD : HC_WORD_CHECKSUM_BAD;
+}
+
+/*
+ * Whole tape decoding. Bytes can be fed in any number of pieces, e.g. as they arrive through a pipe, and each voice
+ * becomes available as soon as its bars part has been read and checksummed.
+ */
+typedef struct {
+    uint32_t *notes;        // notes part data words: tempo, note and end-of-measure words
+    uint32_t notes_count;
+    uint32_t *bars;         // bars part data words: indexes into notes, then end-of-measure
+    uint32_t bars_count;
+} hc_voice_t;
+
+typedef struct {
+    hc_framer_t framer;
+    hc_parts_t parts;
+    uint32_t *words;        // data words of the part being read
+    uint32_t words_count;
+    uint32_t words_capacity;
+    hc_voice_t pending;     // voice whose notes part is done and bars part is being read
+    hc_voice_t *voices;
+    uint32_t voices_count;
+    uint32_t voices_capacity;
+    uint64_t offset;        // bytes fed so far
+    int error;
+    char message[160];
+} hc_decoder_t;
+
+static inline void hc_decoder_init(hc_decoder_t *d) {
+    memset(d, 0, sizeof(*d));
+    hc_parts_init(&d->parts);
+}
+
+static inline void hc_decoder_free(hc_decoder_t *d) {
+    for (uint32_t i = 0; i < d->voices_count; i++) {
+        free(d->voices[i].notes);
+        free(d->voices[i].bars);
+    }
+    free(d->voices);
+    free(d->pending.notes);
+    free(d->words);
+    memset(d, 0, sizeof(*d));
+}
+
+static inline int hc_decoder_fail(hc_decoder_t *d, const char *message) {
+    d->error = 1;
+    snprintf(d->message, sizeof(d->message), "%s at byte %llu", message, (unsigned long long)d->offset);
+    return -1;
+}
+
+static inline int hc_decoder_word(hc_decoder_t *d, uint32_t word) {
+    hc_word_kind_t kind = hc_parts_push(&d->parts, word);
+
+    if (kind == HC_WORD_COUNT) {
+        d->words_count = 0;
+        return 0;
+    }
+
+    if (kind == HC_WORD_DATA) {
+        if (d->words_count == d->words_capacity) {
+            d->words_capacity = d->words_capacity ? d->words_capacity * 2 : 1024;
+            uint32_t *words = realloc(d->words, d->words_capacity * sizeof(uint32_t));
+            if (!words) return hc_decoder_fail(d, "out of memory");
+            d->words = words;
+        }
+        d->words[d->words_count++] = word;
+        return 0;
+    }
+
+    if (kind == HC_WORD_CHECKSUM_BAD) return hc_decoder_fail(d, "checksum mismatch");
+
+    // hand the finished part's words over to the voice, and start a fresh buffer
+    uint32_t *words = d->words;
+    uint32_t count = d->words_count;
+    d->words = NULL;
+    d->words_count = 0;
+    d->words_capacity = 0;
+
+    if (d->parts.kind == HC_PART_NOTES) {
+        d->pending.notes = words;
+        d->pending.notes_count = count;
+        return 0;
+    }
+
+    d->pending.bars = words;
+    d->pending.bars_count = count;
+    if (d->voices_count == d->voices_capacity) {
+        d->voices_capacity = d->voices_capacity ? d->voices_capacity * 2 : 4;
+        hc_voice_t *voices = realloc(d->voices, d->voices_capacity * sizeof(hc_voice_t));
+        if (!voices) return hc_decoder_fail(d, "out of memory");
+        d->voices = voices;
+    }
+    d->voices[d->voices_count++] = d->pending;
+    memset(&d->pending, 0, sizeof(d->pending));
+    return 0;
+}
+
+// feed bytes, returns the number of complete voices so far, or -1 with d->message set
+static inline int hc_decoder_feed(hc_decoder_t *d, const uint8_t *data, size_t length) {
+    uint32_t word;
+
+    if (d->error) return -1;
+
+    for (size_t i = 0; i < length; i++, d->offset++) {
+        if (!hc_framer_push(&d->framer, data[i], &word)) continue;
+        if (d->framer.inner_frames) return hc_decoder_fail(d, "inner blank frame");
+        hc_framer_next(&d->framer);
+        if (hc_decoder_word(d, word)) return -1;
+    }
+
+    return (int)d->voices_count;
+}
+
+// call at EOF, fails if the tape stops in the middle of a word or part
+static inline int hc_decoder_finish(hc_decoder_t *d) {
+    if (d->error) return -1;
+    if (d->framer.frames || d->parts.in_part || d->pending.notes) return hc_decoder_fail(d, "tape ends inside a part");
+    return (int)d->voices_count;
+}
+
+/*
+ * A voice as the player steps through it: every bar's notes in order, with the tempo in effect.
+ */
+typedef struct {
+    uint32_t ticks;         // length in 1/192 whole notes
+    uint32_t tempo;         // raw tempo value in effect
+    uint8_t pitch;          // pitch field, 0 and 1 are rests
+    uint8_t articulation;
+} hc_event_t;
+
+/*
+ * The raw tempo a tape starts at. The compiler punches the tempo word into the first voice only (and tweak changes it
+ * there), while the player's tempo is one setting for every voice, so the other voices start at this one too. Only a
+ * tempo word ahead of the first note counts; a change later in the voice takes effect where it sits.
+ */
+static inline uint32_t hc_song_tempo(const hc_voice_t *first) {
+    uint32_t tempo = HC_DEFAULT_TEMPO;
+    for (uint32_t i = 0; i < first->notes_count && (first->notes[i] & HC_TEMPO_MASK) == HC_TEMPO_MASK; i++) {
+        tempo = first->notes[i] & 0077777;
+    }
+    return tempo;
+}
+
+// expand a voice's bars into events starting at the song's tempo, returns the event count, or -1 when out of memory
+// with *events NULL (the caller frees *events only on success)
+static inline long hc_voice_events(const hc_voice_t *v, uint32_t song_tempo, hc_event_t **events) {
+    size_t capacity = 256;
+    size_t count = 0;
+    uint32_t tempo = song_tempo;
+    hc_note_t note;
+
+    *events = malloc(capacity * sizeof(hc_event_t));
+    if (!*events) return -1;
+
+    for (uint32_t b = 0; b < v->bars_count && v->bars[b] != HC_END_OF_MEASURE; b++) {
+        for (uint32_t i = v->bars[b]; i < v->notes_count && v->notes[i] != HC_END_OF_MEASURE; i++) {
+            uint32_t word = v->notes[i];
+            if ((word & HC_TEMPO_MASK) == HC_TEMPO_MASK) {
+                tempo = word & 0077777;
+                continue;
+            }
+
+            hc_parse_note(word, &note);
+            if (count == capacity) {
+                capacity *= 2;
+                hc_event_t *grown = realloc(*events, capacity * sizeof(hc_event_t));
+                if (!grown) {
+                    free(*events);
+                    *events = NULL;
+                    return -1;
+                }
+                *events = grown;
+            }
+            hc_event_t *e = &(*events)[count++];
+            e->ticks = HC_NOTE_TICKS(note.triplet, note.duration);
+            e->tempo = tempo;
+            e->pitch = note.pitch;
+            e->articulation = note.articulation;
+        }
+    }
+
+    return (long)count;
+}
+
+#endif
@@ -13,66 +13,94 @@
  *         input translates to octal 013.  This is the FIODEC stop command
  *         or something like that.  It's used to seperate the voices on the
  *         input to the harmony compiler.
+ *
+ *  All three modes are driven by 256-entry tables built once at startup,
+ *  and read and write in BLOCK sized chunks.  The tables and the -f
+ *  encoders are in common/hcfiodec.h.  Characters with no FIODEC code
+ *  are dropped by -f, except NUL, which is punched as upper case 012 as
+ *  it always was.
+ *
+ *  On x86 the -f encoder looks up 16 (SSE4.1) or 32 (AVX2) characters at
+ *  a time, picked at run time; -s forces the scalar encoder.
+ *
+ *  --stats writes the run's byte, frame and word counts and the time
+ *  spent per phase as JSON to stderr, --stats=<file> to a file.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
 #ifdef MAC
 #include <console.h>
 #endif /* MAC */
 
+#include "../../common/hcstats.h"
+#include "../../common/hcfiodec.h"
+
 int ascii = 0;
 int fiodec = 0;
+int scalar = 0;
+
+#define BLOCK	65536		/* bytes per read() and write() block */
+
+unsigned char ibuf[BLOCK];
+unsigned char obuf[2 * BLOCK];	/* room for an encoded block, a shift per character at most */
+size_t olen = 0;
+
+void oflush(void);
+
+void oflush(void)
+{
+	if (olen > 0 && fwrite(obuf, 1, olen, stdout) != olen) {
+		perror("ascii2fiodec: write");
+		exit(1);
+	}
+	HC_COUNT(bytes_written, olen);
+	olen = 0;
+}
 
-int upper[0100] = {
-	' ', '"', '\'', '{', '}', '|', '&', '<',
-	'>', '!', 0, '@', 0, 0, 0, 0,
-	':', '?', 'S', 'T', 'U', 'V', 'W', 'X',
-	'Y', 'Z', 0, '=', 0, 0, '\t', 0,
-	'_', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
-	'Q', 'R', 0, 0, '+', ']', '%', '[',
-	0, 'A', 'B', 'C', 'D', 'E', 'F', 'G',
-	'H', 'I', 0, '#', 0, '\b', 0, 0 
-};
-int lower[0100] = {
-	' ', '1', '2', '3', '4', '5', '6', '7',
-	'8', '9', 0, '@', 0, 0, 0, 0,
-	'0', '/', 's', 't', 'u', 'v', 'w', 'x',
-	'y', 'z', 0, ',', 0, 0, '\t', 0,
-	';', 'j', 'k', 'l', 'm', 'n', 'o', 'p',
-	'q', 'r', 0, 0, '-', ')', '~', '(',
-	0, 'a', 'b', 'c', 'd', 'e', 'f', 'g',
-	'h', 'i', 0, '.', 0, '\b', 0, 0
-};
+#define oput(ch)	do { if (olen >= BLOCK) oflush(); obuf[olen++] = (ch); } while (0)
+
+int iread(void);
+
+int iread(void)
+{
+	size_t n = fread(ibuf, 1, BLOCK, stdin);
+	if (n == 0 && ferror(stdin)) {
+		perror("ascii2fiodec: read");
+		exit(1);
+	}
+	HC_COUNT(bytes_read, n);
+	return (int) n;
+}
 
 void newlin(int);
 
 void newlin(int skip)
 {
 	do
-		printf("\n");
+		oput('\n');
 	while (--skip >= 0);
 }
 
-void putpar(int);
+void putoct(int);
 
-void putpar(int ch)
+void putoct(int val)
 {
-	int v, q;
-	for (v = ch, q = 0; v; v = v >> 1)
-		if (v & 1)
-			q++;
-	putchar((q & 1) ? ch : ch+0200);
+	int i;
+	for (i = 15; i >= 0; i -= 3)
+		oput('0' + ((val >> i) & 07));
 }
 
 int main(int argc, char *argv[])
 {
-	int col, skp, cyc, nco, nch, c, val, dot;
+	int col, skp, cyc, nco, c, val, dot, n, i;
 
 #ifdef MAC
 	argc = ccommand(&argv);
 #endif /* MAC */
+	hc_stats_init("ascii2fiodec", &argc, argv);
 	
 	col = 8;
 	skp = 1;
@@ -90,6 +118,9 @@ int main(int argc, char *argv[])
 				case 'f':
 					fiodec = 1;
 					break;
+				case 's':
+					scalar = 1;
+					break;
 			}
 		}
 		else break;
@@ -103,110 +134,87 @@ int main(int argc, char *argv[])
 /*	printf("%d %d\n", col, skp);
 */
 
+	hc_stats_phase("tables");
+	hc_fiodec_init();
+
 	if (ascii) {
+		hc_stats_phase("decode");
 		int uc = 0;
-		for (c = getchar(); c != EOF; c = getchar()) {
-			switch (c) {
-				case 0272:
+		while ((n = iread()) > 0)
+			for (i = 0; i < n; i++) {
+				c = hc_fiodec.decode[uc][ibuf[i]];
+				if (c > 0)
+					oput(c);
+				else if (c == HC_FIODEC_LOWERED)
 					uc = 0;
-					break;
-				case 0274:
+				else if (c == HC_FIODEC_UPPERED)
 					uc = 1;
-					break;
-				case 0277:
-					putchar('\n');
-					break;
-				default:
-					for (nco = 0, nch = c; nch != 0; nch = nch >> 1)
-						if (nch & 1)
-							nco++;
-					if ((nco & 1) == 0)
-						break;
-					if (c & 0100)
-						break;
-					if (uc)
-						dot = upper[c & 077];
-					else
-						dot = lower[c & 077];
-					if (dot != 0)
-						putchar(dot);
 			}
-		}		
+		oflush();
+		hc_stats.counts.frames_read = hc_stats.counts.bytes_read;
+		hc_stats.complete = 1;
 		return  0;
 	}
 	
 	if (fiodec) {
 		int uc = 0;
-		int i;
-		for (c = getchar(); c != EOF; c = getchar()) {
-			if (c == ' ')
-				putchar(0200);
-			else if (c == '\t')
-				putchar(0236);
-			else if (c == '\n')
-				putchar(0277);				
-			else for (i = 0; i < 100; i++) {
-				if (c == upper[i]) {
-					if (!uc) {
-						putchar(0274);
-						uc = 1;
-					}
-					putpar(i);
-					break;
-				}
-				if (c == lower[i]) {
-					if (uc) {
-						putchar(0272);
-						uc = 0;
-					}
-					putpar(i);
-					break;
-				}
-			}
+		hc_fiodec_encoder_t *enc = hc_fiodec_encoder(scalar);
+		hc_stats_phase("encode");
+		while ((n = iread()) > 0) {
+			uc = enc(ibuf, n, uc, obuf, &olen);
+			oflush();
 		}
-		putchar(013);		
+		oput(HC_FIODEC_STOP);
+		oflush();
+		hc_stats.counts.frames_written = hc_stats.counts.bytes_written;
+		hc_stats.complete = 1;
 		return 0;
 	}
 
-	for (nch = cyc = val = nco = dot = 0; ; nch++) {
-		c = getchar();
-		if (c == EOF) {
-			dot = 0;
-			break;
-		}
-		if (c < 0200) {
-			if (dot < 0) {
-				newlin(skp);
-				nco = 0;
-			}
-			dot = 1;
-			putchar('.');
-			if (++nco > col * 8) {
-				newlin(skp);
-				nco = dot = 0;
-			}
-		}
-		else if ((c & 0100) != 0)
-			continue;
-		else {
-			if (dot > 0) {
-				newlin(skp);
-				nco = 0;
-			}
-			dot = -1;
-			val = (val << 6) | (c - 0200);
-			if (++cyc >= 3) {
-				printf("%06o", val);
-				val = cyc = 0;
-				if (++nco > col) {
+	hc_stats_phase("dump");
+	for (cyc = val = nco = dot = 0; (n = iread()) > 0; )
+		for (i = 0; i < n; i++) {
+			c = ibuf[i];
+			if (c < 0200) {
+				HC_COUNT(gap_frames, 1);
+				if (dot < 0) {
+					newlin(skp);
+					nco = 0;
+				}
+				dot = 1;
+				oput('.');
+				if (++nco > col * 8) {
 					newlin(skp);
 					nco = dot = 0;
 				}
-				else
-					printf("  ");
+			}
+			else if ((c & 0100) != 0)
+				continue;
+			else {
+				if (dot > 0) {
+					newlin(skp);
+					nco = 0;
+				}
+				dot = -1;
+				val = (val << 6) | (c - 0200);
+				if (++cyc >= 3) {
+					HC_COUNT(words_read, 1);
+					putoct(val);
+					val = cyc = 0;
+					if (++nco > col) {
+						newlin(skp);
+						nco = dot = 0;
+					}
+					else {
+						oput(' ');
+						oput(' ');
+					}
+				}
 			}
 		}
-	}
+	oflush();
+	hc_stats.counts.frames_read = hc_stats.counts.bytes_read;
+	hc_stats.complete = 1;
 	
 	return 0;
 }
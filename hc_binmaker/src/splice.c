@@ -0,0 +1,129 @@
+/*
+ * splice.c
+ *
+ * This program splices Harmony Compiler intermediate tapes compiled one voice at a time into one multi-voice tape,
+ * laid out as the compiler punches a multi-voice source: for each voice a leader, the notes part, a short gap, the
+ * bars part and a trailer. Every part is checked on the way in and its checksum recomputed on the way out.
+ * Usage: ./splice [-o <out.bin>] <voice.bin>... (use '-' for stdin, an input may hold any number of voices)
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../common/hctape.h"
+
+#define READ_BLOCK 65536
+
+static void usage(void) {
+    fprintf(stderr, "Usage: ./splice [-o <out.bin>] <voice.bin>... (use '-' for stdin)\n");
+}
+
+// decodes every voice of one input tape into the decoder
+static int read_tape(const char *path, hc_decoder_t *decoder) {
+    FILE *fp = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    uint8_t block[READ_BLOCK];
+    size_t n;
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+
+    while ((n = fread(block, 1, sizeof(block), fp)) > 0) {
+        if (hc_decoder_feed(decoder, block, n) < 0) break;
+    }
+    if (fp != stdin) fclose(fp);
+
+    if (hc_decoder_finish(decoder) < 0) {
+        fprintf(stderr, "%s: %s\n", path, decoder->message);
+        return -1;
+    }
+    if (!decoder->voices_count) {
+        fprintf(stderr, "%s: no voices on tape\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *out_path = "-";
+    uint32_t voices = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:h")) != -1) {
+        switch (opt) {
+            case 'o': out_path = optarg; break;
+            default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind == argc) {
+        usage();
+        return 1;
+    }
+
+    // read every input before creating the output, so a bad voice doesn't leave a partial tape behind
+    int inputs = argc - optind;
+    hc_decoder_t *decoders = calloc(inputs, sizeof(hc_decoder_t));
+    if (!decoders) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < inputs; i++) {
+        hc_decoder_init(&decoders[i]);
+        if (read_tape(argv[optind + i], &decoders[i])) return 1;
+    }
+
+    FILE *out = strcmp(out_path, "-") ? fopen(out_path, "wb") : stdout;
+    if (!out) {
+        perror(out_path);
+        return 1;
+    }
+
+    for (int i = 0; i < inputs; i++) {
+        for (uint32_t v = 0; v < decoders[i].voices_count; v++) {
+            const hc_voice_t *voice = &decoders[i].voices[v];
+            hc_blank(out, HC_LEADER_FRAMES);
+            hc_punch_part(out, voice->notes, voice->notes_count);
+            hc_blank(out, HC_INNER_GAP_FRAMES);
+            hc_punch_part(out, voice->bars, voice->bars_count);
+            hc_blank(out, HC_TRAILER_FRAMES);
+            voices++;
+        }
+        hc_decoder_free(&decoders[i]);
+    }
+    free(decoders);
+
+    if (ferror(out) || (out != stdout && fclose(out))) {
+        perror(out_path);
+        return 1;
+    }
+
+    fprintf(stderr, "spliced %u voice%s from %d tape%s\n", voices, voices == 1 ? "" : "s", inputs, inputs == 1 ? "" : "s");
+    return 0;
+}
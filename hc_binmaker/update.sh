@@ -1,5 +1,4 @@
 python3 ../util/merge.py 
 cp ../voices/boc-olson.txt .
 ./ascii2fiodec -f <boc-olson.txt >boc-olson.fio
-rm boc-olson.bin
-./pdp1 hc1-4.ini
+python3 ../util/hccompile.py boc-olson.fio boc-olson.bin hc1_log.txt
@@ -4,7 +4,10 @@ imgbin.py - convert between an 8-pixel-high 1-bit bitmap and a raw binary file.
 
 Usage
 -----
-    python3 imgbin.py <source file> <destination file>
+    python3 imgbin.py <source file> <destination file> [<source file> <destination file> ...]
+
+Any number of source/destination pairs may be given, and each pair is
+converted in turn.
 
 Rules
 -----
@@ -17,6 +20,11 @@ Rules
   - Height = 8 px, width = number of bytes.  
   - Bit 1 → black pixel, bit 0 → white pixel.
 
+Conversion works a chunk of columns at a time, a whole bit-plane per step
+(bytes.translate and big-integer ORs run in C), so it is fast.  The whole
+image is still held as a 1-bit bitmap, so memory grows with the width at one
+bit per pixel (a byte per tape frame), plus one chunk's 8-bit planes.
+
 Requires Pillow (`pip install pillow`).
 """
 
@@ -30,20 +38,28 @@ except ImportError:   # pragma: no cover
 
 HEIGHT = 8                # fixed bitmap height
 BITMAP_MODE = "1"         # 1-bit pixels: 0=black, 255=white
+CHUNK_WIDTH = 1 << 20     # columns converted per step
+
+# BIT_TO_PIXEL[y] maps a byte to the "L" pixel for row y: bit set → black (0), clear → white (255)
+BIT_TO_PIXEL = [bytes(0 if (b >> y) & 1 else 255 for b in range(256)) for y in range(HEIGHT)]
+# PIXEL_TO_BIT[y] maps an "L" pixel in row y to that row's bit: black (0) → 1 << y, anything else → 0
+PIXEL_TO_BIT = [bytes((1 << y) if p == 0 else 0 for p in range(256)) for y in range(HEIGHT)]
 
 
 def bin_to_img(src: Path, dst: Path) -> None:
     """Create a bitmap from a raw binary file."""
-    data = src.read_bytes()
-    width = len(data)
+    width = src.stat().st_size
 
     img = Image.new(BITMAP_MODE, (width, HEIGHT), 255)  # start all-white
-    px = img.load()
 
-    for x, byte in enumerate(data):
-        for y in range(HEIGHT):
-            if (byte >> y) & 1:          # bit set?
-                px[x, y] = 0             # draw black pixel
+    with src.open("rb") as f:
+        x = 0
+        while chunk := f.read(CHUNK_WIDTH):
+            # one "L" row per bit-plane, stacked top (LSB) to bottom (MSB)
+            planes = b"".join(chunk.translate(BIT_TO_PIXEL[y]) for y in range(HEIGHT))
+            part = Image.frombytes("L", (len(chunk), HEIGHT), planes)
+            img.paste(part.convert(BITMAP_MODE, dither=Image.Dither.NONE), (x, 0))
+            x += len(chunk)
 
     img.save(dst, format="BMP")
     print(f"[ok] wrote {dst} ({width}-byte bitmap)")
@@ -59,33 +75,35 @@ def img_to_bin(src: Path, dst: Path) -> None:
     if height != HEIGHT:
         sys.exit("error: bitmap height must be exactly 8 pixels")
 
-    px = img.load()
-    out = bytearray()
+    with dst.open("wb") as out:
+        for x in range(0, width, CHUNK_WIDTH):
+            n = min(CHUNK_WIDTH, width - x)
+            pixels = img.crop((x, 0, x + n, HEIGHT)).convert("L").tobytes()
+            # each plane only sets its own bit, so adding the planes is the same as ORing them
+            packed = sum(
+                int.from_bytes(pixels[y * n:(y + 1) * n].translate(PIXEL_TO_BIT[y]), "little")
+                for y in range(HEIGHT)
+            )
+            out.write(packed.to_bytes(n, "little"))
 
-    for x in range(width):
-        byte = 0
-        for y in range(HEIGHT):
-            bit = 1 if px[x, y] == 0 else 0   # black → 1
-            byte |= bit << y
-        out.append(byte)
-
-    dst.write_bytes(out)
-    print(f"[ok] wrote {dst} ({len(out)} bytes)")
+    print(f"[ok] wrote {dst} ({width} bytes)")
 
 
 def main() -> None:
-    if len(sys.argv) != 3 or sys.argv[1] in ("-h", "--help"):
+    args = sys.argv[1:]
+    if not args or len(args) % 2 or args[0] in ("-h", "--help"):
         print(__doc__)
         sys.exit(1)
 
-    src, dst = map(Path, sys.argv[1:3])
-
-    # Treat source as image if Pillow can open it, otherwise as binary
-    try:
-        with Image.open(src):
+    for src, dst in zip(map(Path, args[0::2]), map(Path, args[1::2])):
+        # Treat source as image if Pillow can open it, otherwise as binary
+        try:
+            with Image.open(src):
+                pass
+        except (OSError, FileNotFoundError):
+            bin_to_img(src, dst)
+        else:
             img_to_bin(src, dst)
-    except (OSError, FileNotFoundError):
-        bin_to_img(src, dst)
 
 
 if __name__ == "__main__":
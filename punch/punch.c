@@ -0,0 +1,612 @@
+/*
+ * punch.c
+ *
+ * This program streams a tape image to a paper tape punch on a serial port, in place of sending it through CoolTerm.
+ * It paces the frames itself: it starts at the line's full rate, backs off each time the punch sends XOFF, and creeps
+ * back up while it doesn't, so a long tape runs as fast as the punch keeps up with. Progress (frames per second,
+ * pauses, ETA) is shown as it goes. When a run is interrupted (Ctrl-C, a hung up port) the offset of the first frame
+ * the punch didn't get is saved, and -R carries on from there on fresh tape.
+ * Usage: ./punch [-b <baud>] [-f xon|rts|none] [-r <fps>] [-o <offset> | -R] [-S <state>] [-q] <device> <tape.bin>
+ *        ./punch -T [<tape.bin>] (self-test against a simulated punch on a pseudo-terminal)
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+
+#include "../common/hctape.h"
+
+// tape punch.CoolTermSettings: 2400 baud, 8N1, XON/XOFF
+#define DEFAULT_BAUD 2400
+#define FRAME_BITS 10               // start bit, 8 data bits, stop bit
+#define XON 0x11
+#define XOFF 0x13
+
+#define BURST_FRAMES 16             // most frames written at once, so little is queued when XOFF comes
+#define BACKOFF 0.9                 // pace multiplier for every XOFF
+#define RAMP 1.05                   // pace multiplier per second once XOFF has been quiet for RAMP_QUIET
+#define RAMP_QUIET 2.0
+#define MIN_PACE_FRACTION 0.1
+#define STALL_SECONDS 30.0          // paused this long, the punch is probably out of tape
+#define REPORT_INTERVAL 0.5
+
+// the self-test's simulated punch: slower than the line, with a small buffer it would overrun without flow control
+#define SIM_RATE 2000.0
+#define SIM_BUFFER 256
+#define SIM_HIGH_WATER 128
+#define SIM_LOW_WATER 32
+#define SIM_IDLE_SECONDS 5.0
+
+typedef enum {
+    FLOW_XON,
+    FLOW_RTS,
+    FLOW_NONE,
+} flow_t;
+
+typedef struct {
+    uint32_t baud;
+    flow_t flow;
+    double max_pace;                // frames per second, 0 for the line's rate
+    int quiet;
+} options_t;
+
+typedef struct {
+    size_t length;
+    size_t offset;                  // where this run started
+    size_t pos;                     // frames handed to the port, then at the end, frames the punch got
+    double pace;
+    double start;
+    double paused_seconds;
+    uint64_t xoffs;
+    uint64_t cts_waits;             // writes refused while RTS/CTS held the line
+    uint64_t stray;                 // bytes from the punch other than XON/XOFF
+} progress_t;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    interrupted = 1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage: ./punch [-b <baud>] [-f xon|rts|none] [-r <fps>] [-o <offset> | -R] [-S <state>] [-q] <device> <tape.bin>\n"
+        "       ./punch -T [<tape.bin>]\n"
+        "  -b  baud rate, 8N1 (default: %d)\n"
+        "  -f  flow control: xon (XON/XOFF from the punch, default), rts (RTS/CTS) or none\n"
+        "  -r  most frames per second (default: the line's rate, baud / %d)\n"
+        "  -o  start at this frame offset\n"
+        "  -R  resume from the offset saved by an interrupted run\n"
+        "  -S  where the resume offset is saved (default: <tape.bin>.offset)\n"
+        "  -q  no progress line\n"
+        "  -T  self-test: punch a tape (or a test pattern) to a simulated punch on a pseudo-terminal, interrupt\n"
+        "      it halfway, resume, and check every frame arrived once, in order\n",
+        DEFAULT_BAUD, FRAME_BITS);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static speed_t baud_constant(uint32_t baud) {
+    switch (baud) {
+        case 110: return B110;
+        case 300: return B300;
+        case 600: return B600;
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        default: return B0;
+    }
+}
+
+// raw 8N1, non-blocking; XON/XOFF are read here rather than by the kernel, so pauses can be seen and paced around
+static int open_device(const char *path, const options_t *opts) {
+    struct termios tio;
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    if (tcgetattr(fd, &tio)) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | PARENB);
+    if (opts->flow == FLOW_RTS) {
+        tio.c_cflag |= CRTSCTS;
+    } else {
+        tio.c_cflag &= ~CRTSCTS;
+    }
+    tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, baud_constant(opts->baud));
+    cfsetospeed(&tio, baud_constant(opts->baud));
+
+    if (tcsetattr(fd, TCSANOW, &tio)) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+// where on the tape a frame offset falls, for telling the operator where the punch stopped
+static void describe(const uint8_t *tape, size_t length, size_t offset, char *text, size_t size) {
+    static const char *KINDS[] = { "notes", "bars" };
+    hc_framer_t framer = {0};
+    hc_parts_t parts;
+    uint32_t word;
+
+    hc_parts_init(&parts);
+    for (size_t i = 0; i < offset && i < length; i++) {
+        if (!hc_framer_push(&framer, tape[i], &word)) continue;
+        hc_framer_next(&framer);
+        hc_parts_push(&parts, word);
+    }
+
+    if (offset >= length) {
+        snprintf(text, size, "end of tape");
+    } else if (parts.in_part) {
+        snprintf(text, size, "voice %u %s part, word %u of %u", parts.voice, KINDS[parts.kind], parts.pos + 2,
+            parts.count + 2);
+    } else if (!parts.parts) {
+        snprintf(text, size, "leader");
+    } else {
+        snprintf(text, size, "gap after voice %u %s part", parts.voice, KINDS[parts.kind]);
+    }
+}
+
+static void report(const progress_t *p, double t, int done) {
+    double elapsed = t - p->start;
+    double fps = elapsed > 0 ? (p->pos - p->offset) / elapsed : 0;
+    double eta = fps > 0 ? (p->length - p->pos) / fps : 0;
+
+    fprintf(stderr, "\r%9zu/%zu frames %3d%%  %6.1f fps (pace %.0f)  %llu XOFF, paused %.1f s  ETA %d:%02d  ",
+        p->pos, p->length, p->length ? (int)(100.0 * p->pos / p->length) : 100, fps, p->pace,
+        (unsigned long long)p->xoffs, p->paused_seconds, (int)eta / 60, (int)eta % 60);
+    if (done) fputc('\n', stderr);
+}
+
+/*
+ * Streams tape[offset..] to the port, stopping early when interrupted or after stop_after frames (0 for no limit).
+ * Returns 0 once every frame has been sent, 1 when stopped early and -1 on a port error; either way p->pos is the
+ * offset of the first frame the punch didn't get.
+ */
+static int stream(int fd, const uint8_t *tape, size_t length, size_t offset, size_t stop_after, const options_t *opts,
+                  progress_t *p) {
+    double max_pace = opts->max_pace ? opts->max_pace : (double)opts->baud / FRAME_BITS;
+    double min_pace = max_pace * MIN_PACE_FRACTION;
+    double allowance = 0;
+    double t = now();
+    double last = t;
+    double last_xoff = t;
+    double last_ramp = t;
+    double next_report = t;
+    double paused_since = 0;
+    int paused = 0;
+    int stalled = 0;
+    int blocked = 0;
+    int status = 0;
+
+    memset(p, 0, sizeof(*p));
+    p->length = length;
+    p->offset = p->pos = offset;
+    p->pace = max_pace;
+    p->start = t;
+
+    while (p->pos < length) {
+        if (interrupted || (stop_after && p->pos - offset >= stop_after)) {
+            status = 1;
+            break;
+        }
+
+        // sleep until the next frame is due, or something comes back from the punch
+        int timeout = 50;
+        if (!paused && !blocked && allowance < 1) {
+            int due = (int)((1 - allowance) / p->pace * 1000) + 1;
+            if (due < timeout) timeout = due;
+        }
+        struct pollfd pfd = { fd, POLLIN | (blocked ? POLLOUT : 0), 0 };
+        if (poll(&pfd, 1, (!paused && !blocked && allowance >= 1) ? 0 : timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            status = -1;
+            break;
+        }
+        t = now();
+
+        if (pfd.revents & POLLIN) {
+            uint8_t in[64];
+            ssize_t n = read(fd, in, sizeof(in));
+            for (ssize_t i = 0; i < n; i++) {
+                if (opts->flow == FLOW_XON && in[i] == XOFF) {
+                    if (!paused) {
+                        paused = 1;
+                        paused_since = t;
+                        p->xoffs++;
+                        p->pace = p->pace * BACKOFF > min_pace ? p->pace * BACKOFF : min_pace;
+                    }
+                    last_xoff = t;
+                } else if (opts->flow == FLOW_XON && in[i] == XON) {
+                    if (paused) {
+                        paused = 0;
+                        stalled = 0;
+                        p->paused_seconds += t - paused_since;
+                    }
+                    last = t;
+                } else {
+                    p->stray++;
+                }
+            }
+        }
+        if (pfd.revents & (POLLERR | POLLHUP)) {
+            fprintf(stderr, "\nport hung up\n");
+            status = -1;
+            break;
+        }
+        if (pfd.revents & POLLOUT) blocked = 0;
+
+        if (paused) {
+            if (!stalled && t - paused_since > STALL_SECONDS) {
+                fprintf(stderr, "\nno XON for %.0f s, is the punch out of tape? (Ctrl-C saves the offset)\n", STALL_SECONDS);
+                stalled = 1;
+            }
+        } else {
+            allowance += (t - last) * p->pace;
+            if (allowance > BURST_FRAMES) allowance = BURST_FRAMES;
+
+            // no XOFF for a while, try a little faster
+            if (t - last_xoff > RAMP_QUIET && t - last_ramp >= 1.0 && p->pace < max_pace) {
+                p->pace = p->pace * RAMP < max_pace ? p->pace * RAMP : max_pace;
+                last_ramp = t;
+            }
+        }
+        last = t;
+
+        if (!paused && !blocked && allowance >= 1) {
+            size_t n = (size_t)allowance;
+            if (n > length - p->pos) n = length - p->pos;
+            if (stop_after && n > offset + stop_after - p->pos) n = offset + stop_after - p->pos;
+            ssize_t written = write(fd, tape + p->pos, n);
+            if (written < 0) {
+                if (errno == EAGAIN) {
+                    // the port's queue is full, with RTS/CTS because the punch dropped CTS
+                    p->cts_waits++;
+                    blocked = 1;
+                } else if (errno != EINTR) {
+                    perror("write");
+                    status = -1;
+                    break;
+                }
+            } else {
+                p->pos += written;
+                allowance -= written;
+            }
+        }
+
+        if (!opts->quiet && t >= next_report) {
+            report(p, t, 0);
+            next_report = t + REPORT_INTERVAL;
+        }
+    }
+
+    if (paused) p->paused_seconds += now() - paused_since;
+    if (status < 0 || (status && opts->flow == FLOW_RTS)) {
+        // frames still in the port's queue may never go out, drop them and resume from the first of them
+        int queued = 0;
+        if (!ioctl(fd, TIOCOUTQ, &queued) && queued > 0) p->pos -= (size_t)queued < p->pos - offset ? (size_t)queued : p->pos - offset;
+        tcflush(fd, TCOFLUSH);
+    } else {
+        // pacing keeps at most a burst queued, and the port sends it even after XOFF, so let it go out
+        tcdrain(fd);
+    }
+
+    if (!opts->quiet) report(p, now(), 1);
+    return status;
+}
+
+static uint8_t *read_tape(const char *path, size_t *length) {
+    FILE *fp = fopen(path, "rb");
+    uint8_t *data = NULL;
+
+    if (!fp) {
+        perror(path);
+        return NULL;
+    }
+    if (!fseek(fp, 0, SEEK_END)) {
+        long size = ftell(fp);
+        rewind(fp);
+        if (size >= 0 && (data = malloc(size ? size : 1))) {
+            *length = fread(data, 1, size, fp);
+        }
+    }
+    fclose(fp);
+    if (!data) fprintf(stderr, "%s: could not read\n", path);
+    return data;
+}
+
+/*
+ * The self-test's punch, on the master side of the pseudo-terminal: it takes frames into a small buffer as they
+ * arrive, punches them (into out) at SIM_RATE, and sends XOFF/XON around its high and low water marks. A frame
+ * arriving to a full buffer is an overrun. Exits 0 when all expected frames were punched without one.
+ */
+static int simulate(int master, size_t expected, FILE *out) {
+    uint8_t buffer[SIM_BUFFER];
+    size_t used = 0;
+    size_t punched = 0;
+    size_t overruns = 0;
+    double credit = 0;
+    double last = now();
+    double last_input = last;
+    int xoff = 0;
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    while (punched < expected) {
+        struct pollfd pfd = { master, POLLIN, 0 };
+        poll(&pfd, 1, 1);
+        double t = now();
+
+        uint8_t in[4096];
+        ssize_t n = read(master, in, sizeof(in));
+        if (n > 0) {
+            last_input = t;
+            for (ssize_t i = 0; i < n; i++) {
+                if (used == SIM_BUFFER) {
+                    overruns++;
+                } else {
+                    buffer[used++] = in[i];
+                }
+            }
+        } else if (t - last_input > SIM_IDLE_SECONDS) {
+            break;
+        } else if (n < 0 && errno == EIO) {
+            // nothing has the slave side open, between runs
+            usleep(1000);
+        }
+
+        credit += (t - last) * SIM_RATE;
+        last = t;
+        size_t k = (size_t)credit < used ? (size_t)credit : used;
+        if (k) {
+            fwrite(buffer, 1, k, out);
+            memmove(buffer, buffer + k, used - k);
+            used -= k;
+            punched += k;
+            credit -= k;
+        }
+        if (!used && credit > 1) credit = 1;
+
+        if (!xoff && used >= SIM_HIGH_WATER) {
+            uint8_t c = XOFF;
+            xoff = write(master, &c, 1) == 1;
+        } else if (xoff && used <= SIM_LOW_WATER) {
+            uint8_t c = XON;
+            xoff = write(master, &c, 1) != 1;
+        }
+    }
+
+    fflush(out);
+    if (overruns) fprintf(stderr, "simulated punch: %zu overruns\n", overruns);
+    return overruns ? 2 : punched == expected ? 0 : 1;
+}
+
+static int self_test(const char *path, int quiet) {
+    options_t opts = { 38400, FLOW_XON, SIM_RATE * 2, quiet };
+    size_t length = 4096;
+    uint8_t *tape;
+    char where[128];
+    progress_t p;
+
+    // the test pattern has every byte value, XON and XOFF included, since tape frames can be either
+    if (path) {
+        if (!(tape = read_tape(path, &length))) return 1;
+    } else {
+        if (!(tape = malloc(length))) return 1;
+        for (size_t i = 0; i < length; i++) tape[i] = (uint8_t)(i * 7 + i / 256);
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) || unlockpt(master)) {
+        perror("pseudo-terminal");
+        return 1;
+    }
+    const char *slave = ptsname(master);
+    FILE *received = tmpfile();
+    if (!slave || !received) {
+        perror("self-test");
+        return 1;
+    }
+
+    fprintf(stderr, "self-test: %zu frames to a simulated punch at %.0f fps on %s, line paced at up to %.0f fps\n",
+        length, SIM_RATE, slave, opts.max_pace);
+    fflush(received);
+    pid_t pid = fork();
+    if (pid == 0) _exit(simulate(master, length, received));
+
+    int fd = open_device(slave, &opts);
+    if (fd < 0) return 1;
+
+    int status = stream(fd, tape, length, 0, length / 2, &opts, &p);
+    describe(tape, length, p.pos, where, sizeof(where));
+    fprintf(stderr, "interrupted at frame %zu (%s), resuming\n", p.pos, where);
+    uint64_t xoffs = p.xoffs;
+    if (status == 1) status = stream(fd, tape, length, p.pos, 0, &opts, &p);
+    xoffs += p.xoffs;
+
+    int sim_status;
+    waitpid(pid, &sim_status, 0);
+    close(fd);
+    close(master);
+
+    size_t got_length;
+    rewind(received);
+    uint8_t *got = malloc(length + 1);
+    got_length = got ? fread(got, 1, length + 1, received) : 0;
+    fclose(received);
+
+    int ok = status == 0 && WIFEXITED(sim_status) && WEXITSTATUS(sim_status) == 0 && got_length == length
+        && !memcmp(got, tape, length) && xoffs > 0;
+    fprintf(stderr, "%s: %zu of %zu frames punched %s, %llu XOFF, final pace %.0f fps\n", ok ? "PASS" : "FAIL",
+        got_length, length, got_length == length && !memcmp(got, tape, length) ? "intact" : "wrong",
+        (unsigned long long)xoffs, p.pace);
+    if (!xoffs) fprintf(stderr, "flow control was never exercised\n");
+
+    free(got);
+    free(tape);
+    return !ok;
+}
+
+int main(int argc, char *argv[]) {
+    options_t opts = { DEFAULT_BAUD, FLOW_XON, 0, 0 };
+    const char *state_path = NULL;
+    long offset = -1;
+    int resume = 0;
+    int test = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:f:r:o:RS:qTh")) != -1) {
+        switch (opt) {
+            case 'b': opts.baud = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'f':
+                if (!strcmp(optarg, "xon")) {
+                    opts.flow = FLOW_XON;
+                } else if (!strcmp(optarg, "rts")) {
+                    opts.flow = FLOW_RTS;
+                } else if (!strcmp(optarg, "none")) {
+                    opts.flow = FLOW_NONE;
+                } else {
+                    usage();
+                    return 1;
+                }
+                break;
+            case 'r': opts.max_pace = strtod(optarg, NULL); break;
+            case 'o': offset = strtol(optarg, NULL, 10); break;
+            case 'R': resume = 1; break;
+            case 'S': state_path = optarg; break;
+            case 'q': opts.quiet = 1; break;
+            case 'T': test = 1; break;
+            default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (test) return self_test(optind < argc ? argv[optind] : NULL, opts.quiet);
+
+    if (optind != argc - 2 || baud_constant(opts.baud) == B0 || opts.max_pace < 0 || (resume && offset >= 0)) {
+        if (baud_constant(opts.baud) == B0) fprintf(stderr, "unsupported baud rate %u\n", opts.baud);
+        usage();
+        return 1;
+    }
+    const char *device = argv[optind];
+    const char *tape_path = argv[optind + 1];
+
+    size_t length;
+    uint8_t *tape = read_tape(tape_path, &length);
+    if (!tape) return 1;
+
+    char default_state[4096];
+    if (!state_path) {
+        snprintf(default_state, sizeof(default_state), "%s.offset", tape_path);
+        state_path = default_state;
+    }
+    if (resume) {
+        FILE *fp = fopen(state_path, "r");
+        if (!fp || fscanf(fp, "%ld", &offset) != 1) {
+            fprintf(stderr, "%s: no saved offset to resume from\n", state_path);
+            return 1;
+        }
+        fclose(fp);
+    }
+    if (offset < 0) offset = 0;
+    if ((size_t)offset > length) {
+        fprintf(stderr, "offset %ld is past the end of the tape (%zu frames)\n", offset, length);
+        return 1;
+    }
+
+    int fd = open_device(device, &opts);
+    if (fd < 0) return 1;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    char where[128];
+    describe(tape, length, offset, where, sizeof(where));
+    fprintf(stderr, "punching %s to %s from frame %ld (%s), %u baud, %s flow control\n", tape_path, device, offset,
+        where, opts.baud, opts.flow == FLOW_XON ? "XON/XOFF" : opts.flow == FLOW_RTS ? "RTS/CTS" : "no");
+
+    progress_t p;
+    int status = stream(fd, tape, length, offset, 0, &opts, &p);
+    close(fd);
+
+    if (status) {
+        describe(tape, length, p.pos, where, sizeof(where));
+        FILE *fp = fopen(state_path, "w");
+        if (fp) {
+            fprintf(fp, "%zu\n", p.pos);
+            fclose(fp);
+        }
+        fprintf(stderr, "stopped at frame %zu (%s), saved to %s; resume with -R\n", p.pos, where, state_path);
+    } else {
+        unlink(state_path);
+        fprintf(stderr, "punched %zu frames in %.1f s, %llu XOFF, %.1f s paused", length - offset, now() - p.start,
+            (unsigned long long)p.xoffs, p.paused_seconds);
+        if (p.cts_waits) fprintf(stderr, ", %llu CTS waits", (unsigned long long)p.cts_waits);
+        if (p.stray) fprintf(stderr, ", %llu unexpected bytes from the punch", (unsigned long long)p.stray);
+        fprintf(stderr, "\n");
+    }
+
+    free(tape);
+    return status ? 1 : 0;
+}
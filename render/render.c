@@ -0,0 +1,560 @@
+/*
+ * render.c
+ *
+ * This program renders a Harmony Compiler intermediate binary paper tape image to a preview WAV file, so an
+ * arrangement can be heard without loading the tape into the PDP-1 (or the simulator).
+ * Usage: ./render [-o <out.wav>] [-r <rate>] [-c] [-t <tempo>] [-p] [-s <tempos>] [-m <speeds>] [-j <threads>] <file>
+ *        (use '-' for stdin)
+ *        ./render -T (self-test: a tape re-tempo'd the way tweak does it must render with every voice ending together)
+ *
+ * Each voice is a square wave, mixed like the simulator: voices 1 and 2 on the left, 3 and 4 on the right. How long a
+ * note sounds for each articulation is an approximation by ear of the player's release, not a measurement.
+ *
+ * With -s and/or -m it sweeps: the tape is decoded once and every combination of tempo and speed is rendered from the
+ * same events, several at a time, each to its own file, with a table of their tempos and durations on stdout. It's
+ * for choosing the tempo word for a particular PDP-1 without a tweak and render per candidate.
+ *
+ * With -p the tape is decoded as it arrives, e.g. through a pipe from the compile step, and each voice is rendered as
+ * soon as its bars part checks out, while the rest of the tape is still coming. A sample can't be written until every
+ * voice that might sound in it is known, and only the end of the tape says there are no more voices, so the WAV still
+ * starts at EOF, but by then only the last voice is left to render.
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../common/hctape.h"
+#include "../common/hcrender.h"
+
+#define MAX_SWEEP 256
+
+// the decoded tape, shared read-only by every render
+typedef struct {
+    uint32_t voices;
+    uint32_t tempo;         // raw tempo from the first voice's tempo word, every voice starts at it
+    hc_event_t **events;
+    long *counts;
+} song_t;
+
+typedef struct {
+    hc_render_options_t opts;
+    char *path;             // owned, for sweep variants
+    double seconds;
+    int status;
+} variant_t;
+
+typedef struct {
+    const song_t *song;
+    variant_t *variants;
+    uint32_t count;
+    atomic_uint next;
+} sweep_t;
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage: ./render [-o <out.wav>] [-r <rate>] [-c] [-t <tempo>] [-p] <file> (use '-' for stdin)\n"
+        "       ./render -T\n"
+        "  -o  output WAV file (default: render.wav, '-' for stdout)\n"
+        "  -r  sample rate (default: %d)\n"
+        "  -c  play at the CHM PDP-1's speed, %d%% of spec, lowering pitch and tempo together\n"
+        "  -t  override every voice's raw tempo value\n"
+        "  -p  render each voice as soon as it's read, for tapes arriving through a pipe\n"
+        "  -s  sweep raw tempo values, a comma separated list of values and from-to/step ranges, 0 for the tape's\n"
+        "      own (e.g. 0,90-110/5), each rendered to <out>-t<tempo>.wav\n"
+        "  -m  sweep speed multipliers, a comma separated list (e.g. 1,0.94), adding -x<speed> to the file names\n"
+        "  -j  renders at once when sweeping (default: one per CPU)\n"
+        "  -T  self-test: render a tape with its tempo word changed in the first voice only, as tweak leaves it, and\n"
+        "      check every voice ends together\n",
+        HC_DEFAULT_SAMPLE_RATE, (int)(CHM_PDP1_CPU_SPEED_MULTIPLIER * 100));
+}
+
+// renders one variant of the song to its WAV file, leaving how long it runs in v->seconds
+static int render(const song_t *song, variant_t *v) {
+    const hc_render_options_t *opts = &v->opts;
+
+    v->seconds = 0;
+    for (uint32_t i = 0; i < song->voices; i++) {
+        double voice = hc_voice_seconds(song->events[i], song->counts[i], opts);
+        if (voice > v->seconds) v->seconds = voice;
+    }
+
+    size_t frames = (size_t)(v->seconds * opts->sample_rate + 0.5);
+    float *left = calloc(frames + 1, sizeof(float));
+    float *right = calloc(frames + 1, sizeof(float));
+    if (!left || !right) {
+        fprintf(stderr, "out of memory\n");
+        free(left);
+        free(right);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < song->voices; i++) {
+        hc_render_voice(song->events[i], song->counts[i], opts, (i % 4) < 2 ? left : right, frames);
+    }
+
+    int status = -1;
+    FILE *out = strcmp(opts->out_path, "-") ? fopen(opts->out_path, "wb") : stdout;
+    if (out) {
+        status = hc_write_wav(out, left, right, frames, opts->sample_rate);
+        if (out != stdout && fclose(out)) status = -1;
+    }
+    if (status) perror(opts->out_path);
+
+    free(left);
+    free(right);
+    return status;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// renders a decoded voice into its channel, growing both channels to fit it
+static int render_voice_progressive(const hc_voice_t *voice, uint32_t index, uint32_t song_tempo, const hc_render_options_t *opts,
+                                    float **left, float **right, size_t *frames, size_t *capacity) {
+    hc_event_t *events;
+    long count = hc_voice_events(voice, song_tempo, &events);
+    if (count < 0) return -1;
+
+    // render() clips notes at the longest voice, which is at least this voice plus the sample a legato end can round up
+    // to, so the same limit gives the same samples whichever voice turns out longest
+    size_t voice_frames = (size_t)(hc_voice_seconds(events, count, opts) * opts->sample_rate + 0.5);
+    if (voice_frames + 2 > *capacity) {
+        size_t grown = voice_frames + 2;
+        float *l = realloc(*left, grown * sizeof(float));
+        if (l) *left = l;
+        float *r = l ? realloc(*right, grown * sizeof(float)) : NULL;
+        if (!r) {
+            free(events);
+            return -1;
+        }
+        *right = r;
+        memset(*left + *capacity, 0, (grown - *capacity) * sizeof(float));
+        memset(*right + *capacity, 0, (grown - *capacity) * sizeof(float));
+        *capacity = grown;
+    }
+    if (voice_frames > *frames) *frames = voice_frames;
+
+    hc_render_voice(events, count, opts, (index % 4) < 2 ? *left : *right, voice_frames + 1);
+    free(events);
+    return 0;
+}
+
+// -p: reads with read() so each voice is rendered as soon as its bytes are in, not when a stdio buffer fills
+static int render_progressive(FILE *fp, const char *name, const hc_render_options_t *opts) {
+    double started = now_seconds();
+    double first_voice = 0;
+    hc_decoder_t decoder;
+    float *left = NULL;
+    float *right = NULL;
+    size_t frames = 0;
+    size_t capacity = 0;
+    uint32_t rendered = 0;
+    uint8_t block[HC_READ_BLOCK];
+    int status = 1;
+
+    hc_decoder_init(&decoder);
+    for (;;) {
+        ssize_t n = read(fileno(fp), block, sizeof(block));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            perror(name);
+            goto done;
+        }
+
+        int voices = n ? hc_decoder_feed(&decoder, block, (size_t)n) : hc_decoder_finish(&decoder);
+        if (voices < 0) {
+            fprintf(stderr, "%s: %s\n", name, decoder.message);
+            goto done;
+        }
+        for (; rendered < (uint32_t)voices; rendered++) {
+            // the first voice, which carries the tempo word, is always the first to arrive
+            uint32_t song_tempo = hc_song_tempo(&decoder.voices[0]);
+            if (render_voice_progressive(&decoder.voices[rendered], rendered, song_tempo, opts, &left, &right, &frames,
+                                         &capacity)) {
+                fprintf(stderr, "out of memory\n");
+                goto done;
+            }
+            if (!rendered) first_voice = now_seconds() - started;
+        }
+        if (!n) break;
+    }
+
+    if (!rendered) {
+        fprintf(stderr, "%s: no voices on tape\n", name);
+        goto done;
+    }
+
+    double tape_done = now_seconds() - started;
+    FILE *out = strcmp(opts->out_path, "-") ? fopen(opts->out_path, "wb") : stdout;
+    if (out) {
+        status = hc_write_wav(out, left, right, frames, opts->sample_rate);
+        if (out != stdout && fclose(out)) status = -1;
+    }
+    if (status) {
+        perror(opts->out_path);
+        status = 1;
+        goto done;
+    }
+    fprintf(stderr, "%u voices, %.1f seconds, first voice rendered at %.3f s, tape complete at %.3f s\n", rendered,
+        (double)frames / opts->sample_rate, first_voice, tape_done);
+
+done:
+    free(left);
+    free(right);
+    hc_decoder_free(&decoder);
+    return status;
+}
+
+#define SELF_TEST_TEMPO 95
+#define SELF_TEST_MEASURES 8
+
+/*
+ * -T: a four voice tape whose tempo word is in the first voice only and isn't the default, the way tweak leaves a
+ * re-tempo'd tape. Each voice splits its measure differently (whole notes down to eighths, all legato), so every voice
+ * must run the same length and its last sample must land on the same frame, which only holds if the voices without a
+ * tempo word play at the first voice's tempo.
+ */
+static int self_test(const hc_render_options_t *opts) {
+    char *tape = NULL;
+    size_t length = 0;
+    FILE *fp = open_memstream(&tape, &length);
+    if (!fp) {
+        perror("self-test");
+        return 1;
+    }
+
+    hc_blank(fp, HC_LEADER_FRAMES);
+    for (uint32_t voice = 1; voice <= 4; voice++) {
+        uint32_t notes[16];
+        uint32_t count = 0;
+        uint32_t bars[SELF_TEST_MEASURES + 1];
+
+        if (voice == 1) notes[count++] = HC_TEMPO_MASK | SELF_TEST_TEMPO;
+        uint32_t measure = count;
+        for (uint32_t n = 0; n < 1u << (voice - 1); n++) {
+            notes[count++] = HC_NOTE_WORD(8, 0, 38 + voice, 64 >> (voice - 1));
+        }
+        notes[count++] = HC_END_OF_MEASURE;
+        for (uint32_t m = 0; m < SELF_TEST_MEASURES; m++) bars[m] = measure;
+        bars[SELF_TEST_MEASURES] = HC_END_OF_MEASURE;
+
+        hc_punch_part(fp, notes, count);
+        hc_blank(fp, HC_INNER_GAP_FRAMES);
+        hc_punch_part(fp, bars, SELF_TEST_MEASURES + 1);
+        hc_blank(fp, HC_TRAILER_FRAMES + (voice < 4 ? HC_LEADER_FRAMES : 0));
+    }
+    fclose(fp);
+
+    hc_decoder_t decoder;
+    hc_decoder_init(&decoder);
+    hc_decoder_feed(&decoder, (const uint8_t *)tape, length);
+    free(tape);
+    if (hc_decoder_finish(&decoder) != 4) {
+        fprintf(stderr, "self-test: the test tape didn't decode to 4 voices: %s\n", decoder.message);
+        hc_decoder_free(&decoder);
+        return 1;
+    }
+
+    uint32_t song_tempo = hc_song_tempo(&decoder.voices[0]);
+    double expected = SELF_TEST_MEASURES * HC_TICKS_PER_WHOLE * hc_tick_seconds(SELF_TEST_TEMPO) / opts->speed;
+    size_t frames = (size_t)(expected * opts->sample_rate + 0.5);
+    float *samples = malloc((frames + 1) * sizeof(float));
+    int status = song_tempo == SELF_TEST_TEMPO ? 0 : 1;
+
+    fprintf(stderr, "self-test: song tempo raw %u, expected %u; every voice should end at %.3f s, frame %zu\n",
+        song_tempo, SELF_TEST_TEMPO, expected, frames);
+    for (uint32_t v = 0; v < 4 && samples; v++) {
+        hc_event_t *events;
+        long count = hc_voice_events(&decoder.voices[v], song_tempo, &events);
+        if (count < 0) {
+            status = 1;
+            break;
+        }
+
+        // a voice rendered alone into a buffer with a frame to spare, so one running long shows up
+        memset(samples, 0, (frames + 1) * sizeof(float));
+        hc_render_voice(events, count, opts, samples, frames + 1);
+        size_t end = frames + 1;
+        while (end > 0 && samples[end - 1] == 0) end--;
+        double seconds = hc_voice_seconds(events, count, opts);
+        free(events);
+
+        int ok = end == frames && fabs(seconds - expected) < 1e-9;
+        fprintf(stderr, "  voice %u: %.3f s, last sample at frame %zu%s\n", v + 1, seconds, end, ok ? "" : " (wrong)");
+        if (!ok) status = 1;
+    }
+    if (!samples) {
+        fprintf(stderr, "out of memory\n");
+        status = 1;
+    }
+
+    // a tempo change partway through the first voice isn't where the song starts
+    uint32_t late[] = { HC_NOTE_WORD(8, 0, 39, 64), HC_END_OF_MEASURE, HC_TEMPO_MASK | SELF_TEST_TEMPO,
+        HC_NOTE_WORD(8, 0, 39, 64), HC_END_OF_MEASURE };
+    hc_voice_t changing = { .notes = late, .notes_count = sizeof(late) / sizeof(late[0]) };
+    uint32_t late_tempo = hc_song_tempo(&changing);
+    if (late_tempo != HC_DEFAULT_TEMPO) status = 1;
+    fprintf(stderr, "self-test: a voice changing tempo after its first measure starts at raw %u, expected %u\n",
+        late_tempo, HC_DEFAULT_TEMPO);
+
+    fprintf(stderr, "self-test: %s\n", status ? "FAILED" : "passed");
+    free(samples);
+    hc_decoder_free(&decoder);
+    return status;
+}
+
+static void *sweep_worker(void *arg) {
+    sweep_t *sweep = arg;
+    uint32_t i;
+
+    while ((i = atomic_fetch_add(&sweep->next, 1)) < sweep->count) {
+        sweep->variants[i].status = render(sweep->song, &sweep->variants[i]);
+    }
+
+    return NULL;
+}
+
+// parses "0,90-110/5" style lists of raw tempos, returning how many or -1
+static int parse_tempos(const char *list, uint32_t *tempos) {
+    int count = 0;
+    char *end;
+
+    while (*list) {
+        uint32_t from = (uint32_t)strtoul(list, &end, 0);
+        uint32_t to = from;
+        uint32_t step = 1;
+
+        if (end == list) return -1;
+        if (*end == '-') {
+            list = end + 1;
+            to = (uint32_t)strtoul(list, &end, 0);
+            if (end == list || to < from) return -1;
+            if (*end == '/') {
+                list = end + 1;
+                step = (uint32_t)strtoul(list, &end, 0);
+                if (end == list || !step) return -1;
+            }
+        }
+        for (uint32_t t = from; t <= to; t += step) {
+            if (count == MAX_SWEEP || t > 0077777) return -1;
+            tempos[count++] = t;
+        }
+        if (*end && *end != ',') return -1;
+        list = *end ? end + 1 : end;
+    }
+
+    return count;
+}
+
+static int parse_speeds(const char *list, double *speeds) {
+    int count = 0;
+    char *end;
+
+    while (*list) {
+        double speed = strtod(list, &end);
+        if (end == list || speed <= 0 || count == MAX_SWEEP || (*end && *end != ',')) return -1;
+        speeds[count++] = speed;
+        list = *end ? end + 1 : end;
+    }
+
+    return count;
+}
+
+// <out>-t<tempo>[-x<speed>].wav (-tape for the tape's own tempos), where out is the -o path without .wav
+static char *variant_path(const char *out_path, uint32_t tempo, double speed, int with_speed) {
+    size_t base = strlen(out_path);
+    if (base > 4 && !strcmp(out_path + base - 4, ".wav")) base -= 4;
+
+    char *path = malloc(base + 48);
+    if (!path) return NULL;
+    int n = sprintf(path, "%.*s", (int)base, out_path);
+    n += tempo ? sprintf(path + n, "-t%u", tempo) : sprintf(path + n, "-tape");
+    if (with_speed) n += sprintf(path + n, "-x%g", speed);
+    strcpy(path + n, ".wav");
+    return path;
+}
+
+int main(int argc, char *argv[]) {
+    hc_render_options_t opts = { "render.wav", HC_DEFAULT_SAMPLE_RATE, 1.0, 0 };
+    uint32_t tempos[MAX_SWEEP];
+    double speeds[MAX_SWEEP];
+    int tempos_count = 0;
+    int speeds_count = 0;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int progressive = 0;
+    int test = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:r:ct:ps:m:j:Th")) != -1) {
+        switch (opt) {
+            case 'o': opts.out_path = optarg; break;
+            case 'r': opts.sample_rate = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'c': opts.speed = CHM_PDP1_CPU_SPEED_MULTIPLIER; break;
+            case 't': opts.tempo = (uint32_t)strtoul(optarg, NULL, 0) & 0077777; break;
+            case 'p': progressive = 1; break;
+            case 'T': test = 1; break;
+            case 's':
+                if ((tempos_count = parse_tempos(optarg, tempos)) <= 0) {
+                    fprintf(stderr, "bad tempo list (up to %d raw tempos of at most %d): %s\n", MAX_SWEEP, 0077777, optarg);
+                    return 1;
+                }
+                break;
+            case 'm':
+                if ((speeds_count = parse_speeds(optarg, speeds)) <= 0) {
+                    fprintf(stderr, "bad speed list (up to %d positive multipliers): %s\n", MAX_SWEEP, optarg);
+                    return 1;
+                }
+                break;
+            case 'j': jobs = atol(optarg); break;
+            default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (test) return self_test(&opts);
+
+    int sweeping = tempos_count || speeds_count;
+    if (optind != argc - 1 || !opts.sample_rate || (sweeping && (progressive || !strcmp(opts.out_path, "-")))) {
+        usage();
+        return 1;
+    }
+
+    FILE *fp = strcmp(argv[optind], "-") ? fopen(argv[optind], "rb") : stdin;
+    if (!fp) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if (progressive) {
+        int status = render_progressive(fp, argv[optind], &opts);
+        if (fp != stdin) fclose(fp);
+        return status;
+    }
+
+    size_t length;
+    uint8_t *data = hc_read_all(fp, &length);
+    if (fp != stdin) fclose(fp);
+    if (!data) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    hc_decoder_t decoder;
+    hc_decoder_init(&decoder);
+    hc_decoder_feed(&decoder, data, length);
+    free(data);
+    if (hc_decoder_finish(&decoder) < 0) {
+        fprintf(stderr, "%s: %s\n", argv[optind], decoder.message);
+        hc_decoder_free(&decoder);
+        return 1;
+    }
+    if (!decoder.voices_count) {
+        fprintf(stderr, "%s: no voices on tape\n", argv[optind]);
+        hc_decoder_free(&decoder);
+        return 1;
+    }
+
+    song_t song = { decoder.voices_count, hc_song_tempo(&decoder.voices[0]), NULL, NULL };
+    song.events = calloc(song.voices, sizeof(hc_event_t *));
+    song.counts = calloc(song.voices, sizeof(long));
+    if (!song.events || !song.counts) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (uint32_t v = 0; v < song.voices; v++) {
+        song.counts[v] = hc_voice_events(&decoder.voices[v], song.tempo, &song.events[v]);
+        if (song.counts[v] < 0) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    int status = 0;
+    if (!sweeping) {
+        variant_t variant = { opts, NULL, 0, 0 };
+        if (render(&song, &variant)) return 1;
+        fprintf(stderr, "%u voices, %.1f seconds\n", song.voices, variant.seconds);
+    } else {
+        // without a list, the one tempo or speed from the other options
+        if (!tempos_count) tempos[tempos_count++] = opts.tempo;
+        if (!speeds_count) speeds[speeds_count++] = opts.speed;
+
+        sweep_t sweep = { &song, calloc(tempos_count * speeds_count, sizeof(variant_t)), 0, 0 };
+        if (!sweep.variants) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        for (int t = 0; t < tempos_count; t++) {
+            for (int x = 0; x < speeds_count; x++) {
+                variant_t *v = &sweep.variants[sweep.count++];
+                v->opts = opts;
+                v->opts.tempo = tempos[t];
+                v->opts.speed = speeds[x];
+                v->opts.out_path = v->path = variant_path(opts.out_path, tempos[t], speeds[x], speeds_count > 1);
+                if (!v->path) {
+                    fprintf(stderr, "out of memory\n");
+                    return 1;
+                }
+            }
+        }
+
+        if (jobs < 1) jobs = 1;
+        if (jobs > sweep.count) jobs = sweep.count;
+        pthread_t threads[jobs];
+        long started = 0;
+        while (started < jobs - 1 && !pthread_create(&threads[started], NULL, sweep_worker, &sweep)) started++;
+        sweep_worker(&sweep);
+        for (long i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+        // the quarter note BPM is for the song's starting tempo when the tape's own tempos are used
+        printf("%u voices\n%6s %6s %6s %9s  %s\n", song.voices, "tempo", "BPM", "speed", "seconds", "file");
+        for (uint32_t i = 0; i < sweep.count; i++) {
+            variant_t *v = &sweep.variants[i];
+            uint32_t tempo = v->opts.tempo ? v->opts.tempo : song.tempo;
+            char name[16] = "tape";
+            if (v->opts.tempo) snprintf(name, sizeof(name), "%u", v->opts.tempo);
+            printf("%6s %6.0f %6.3g %9.1f  %s%s\n", name, hc_decode_tempo_quarter(tempo) * v->opts.speed,
+                v->opts.speed, v->seconds, v->path, v->status ? " (failed)" : "");
+            if (v->status) status = 1;
+            free(v->path);
+        }
+        free(sweep.variants);
+    }
+
+    for (uint32_t v = 0; v < song.voices; v++) free(song.events[v]);
+    free(song.events);
+    free(song.counts);
+    hc_decoder_free(&decoder);
+    return status;
+}
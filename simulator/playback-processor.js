@@ -6,12 +6,13 @@ class ScorePlayback {
   constructor(score, bpm, beatsPerMeasure = 4) {
     this.score = score;
     this.bpm = bpm;
-    this.notes = this.parseScore(score);
     this.beatsPerMeasure = beatsPerMeasure;
+    Object.assign(this, this.parseScore(score));
+    this.cursor = 0;
   }
 
   get measures() {
-    return this.notes.reduce((acc, { duration }) => acc + 1 / duration, 0);
+    return this.length;
   }
 
   get duration() {
@@ -22,20 +23,53 @@ class ScorePlayback {
     // each note is separate by a space or newline. Each note is in the format "{note}t{duration}". {note} has a value
     // such as c3, d4, etc. {duration} is is a fraction of a whole note: 1, 2, 4, 8, 16, 32, or 64. Anything else is
     // is ignored.
-    let notes = [];
-    let noteStrings = score.split(/[ \n]/g);
-    for (let noteString of noteStrings) {
-      let note = noteString.match(/^[a-gA-GrRr][#b]?(?:\d+)?/);
-      let duration = noteString.match(/t\d+$/);
-      if (note && duration) {
-        notes.push({
-          note: note[0],
-          duration: parseInt(duration[0].substring(1), 10)
-        });
+    // The notes on a line make a measure. Each different measure is stored once in measureTable, and the timeline is
+    // measureSequence, indexes into the table, the way the intermediate tape's bars part refers into its notes part.
+    // measureStarts is where each measure of the sequence starts, and length the whole score, in whole notes.
+    const measureTable = [];
+    const measureSequence = [];
+    const measureStarts = [];
+    const measureIndexes = new Map();
+    let length = 0;
+
+    for (let line of score.split('\n')) {
+      // a repeated line is only parsed the first time, measure number aside
+      const key = line.replace(/^\s*\d+\s/, '').trim();
+      let index = measureIndexes.get(key);
+      if (index === undefined) {
+        let notes = [];
+        let offset = 0;
+        for (let noteString of key.split(' ')) {
+          let note = noteString.match(/^[a-gA-GrRr][#b]?(?:\d+)?/);
+          let duration = noteString.match(/t\d+$/);
+          if (note && duration) {
+            duration = parseInt(duration[0].substring(1), 10);
+            notes.push({ note: note[0], duration, offset });
+            offset += 1 / duration;
+          }
+        }
+
+        index = notes.length > 0 ? measureTable.length : -1;
+        measureIndexes.set(key, index);
+        if (index >= 0) {
+          measureTable.push({ notes, length: offset });
+        }
       }
+      if (index < 0) {
+        continue;
+      }
+
+      measureSequence.push(index);
+      measureStarts.push(length);
+      length += measureTable[index].length;
     }
 
-    return notes;
+    return {
+      measureTable,
+      measureSequence: Uint32Array.from(measureSequence),
+      measureStarts: Float64Array.from(measureStarts),
+      length,
+    };
   }
 
   getNoteAtTime(time) {
@@ -45,18 +79,36 @@ class ScorePlayback {
 
     const secondsPerBeat = 60 / this.bpm;
     const wholeNoteDurationSeconds = secondsPerBeat * this.beatsPerMeasure;
+    const position = time / wholeNoteDurationSeconds;
+    if (position >= this.length) {
+      return null;
+    }
 
-    let timeSoFar = 0;
-    for (let i = 0; i < this.notes.length; i++) {
-      const { note, duration } = this.notes[i];
-      const noteDurationSeconds = wholeNoteDurationSeconds / duration;
-      if (time >= timeSoFar && time < timeSoFar + noteDurationSeconds) {
-        return note;
+    // playback asks a sample at a time, so the measure is usually the one from last time, else search the starts
+    const starts = this.measureStarts;
+    let i = this.cursor;
+    if (!(position >= starts[i] && (i + 1 === starts.length || position < starts[i + 1]))) {
+      let low = 0;
+      let high = starts.length - 1;
+      while (low < high) {
+        const mid = (low + high + 1) >> 1;
+        if (starts[mid] <= position) {
+          low = mid;
+        } else {
+          high = mid - 1;
+        }
       }
-      timeSoFar += noteDurationSeconds;
+      i = this.cursor = low;
+    }
+
+    const { notes } = this.measureTable[this.measureSequence[i]];
+    const offset = position - starts[i];
+    let n = notes.length - 1;
+    while (n > 0 && notes[n].offset > offset) {
+      n--;
     }
 
-    return null;
+    return notes[n].note;
   }
 }
 
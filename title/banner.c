@@ -0,0 +1,321 @@
+/*
+ * banner.c
+ *
+ * This program renders text straight into punched tape frames for a readable tape leader, in the 5x6 dot font the
+ * MACRO assembler punches for the title line of a program, so title.mac no longer needs a two pass MACRO run in the
+ * emulator, strip.py and an imgbin.py round trip to become title.bin.
+ * Usage: ./banner [-m <MACRO source>] [-o <output file>] [-p <preview BMP>] [-l <leading frames>] [-L <total frames>] [text]
+ *   -m  use the first line of a MACRO source file (e.g. title.mac) as the text, without its leading blanks
+ *   -o  binary tape output (default: title.bin, use '-' for stdout)
+ *   -p  also write an 8 pixel high 1-bit BMP preview, in the same layout imgbin.py reads and writes
+ *   -l  blank frames before the text (default: 32, as punched by MACRO)
+ *   -L  pad the output with blank frames to exactly this many frames, e.g. the leader length of the tape
+ * An ASCII preview is always printed (to stderr when the tape goes to stdout).
+ * 
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#define GLYPH_WIDTH 5
+#define CELL_WIDTH 6            // glyph plus one blank frame between characters
+#define FRAME_HEIGHT 8
+#define DEFAULT_LEADING_FRAMES 32
+#define MAX_TEXT_LENGTH 4096
+
+/*
+ * One frame per glyph column, bit 0 is the top row. Letters are upper case only, like MACRO's title punch. The glyphs
+ * for B C D J L N O P S T W 0 1 2 5 - = were read back from MACRO's punch of title.mac in output/boc-olson.bin, the
+ * rest are drawn to match. Only characters with a FIODEC code are defined.
+ */
+static const uint8_t FONT[128][GLYPH_WIDTH] = {
+    [' '] = { 000, 000, 000, 000, 000 },
+    ['A'] = { 076, 011, 011, 011, 076 },
+    ['B'] = { 077, 045, 045, 045, 032 },
+    ['C'] = { 036, 041, 041, 041, 022 },
+    ['D'] = { 077, 041, 041, 041, 036 },
+    ['E'] = { 077, 045, 045, 045, 041 },
+    ['F'] = { 077, 005, 005, 005, 001 },
+    ['G'] = { 036, 041, 041, 051, 032 },
+    ['H'] = { 077, 004, 004, 004, 077 },
+    ['I'] = { 000, 041, 077, 041, 000 },
+    ['J'] = { 020, 040, 040, 040, 037 },
+    ['K'] = { 077, 004, 014, 022, 041 },
+    ['L'] = { 077, 040, 040, 040, 040 },
+    ['M'] = { 077, 002, 014, 002, 077 },
+    ['N'] = { 077, 002, 014, 020, 077 },
+    ['O'] = { 036, 041, 041, 041, 036 },
+    ['P'] = { 077, 011, 011, 011, 006 },
+    ['Q'] = { 036, 041, 051, 021, 056 },
+    ['R'] = { 077, 011, 011, 031, 046 },
+    ['S'] = { 022, 045, 045, 045, 030 },
+    ['T'] = { 001, 001, 077, 001, 001 },
+    ['U'] = { 037, 040, 040, 040, 037 },
+    ['V'] = { 017, 020, 040, 020, 017 },
+    ['W'] = { 037, 060, 010, 060, 037 },
+    ['X'] = { 041, 022, 014, 022, 041 },
+    ['Y'] = { 001, 002, 074, 002, 001 },
+    ['Z'] = { 061, 051, 045, 043, 041 },
+    ['0'] = { 036, 041, 041, 041, 036 },
+    ['1'] = { 000, 042, 077, 040, 000 },
+    ['2'] = { 062, 051, 051, 051, 046 },
+    ['3'] = { 041, 045, 045, 045, 032 },
+    ['4'] = { 010, 014, 012, 077, 010 },
+    ['5'] = { 027, 045, 045, 045, 031 },
+    ['6'] = { 036, 045, 045, 045, 030 },
+    ['7'] = { 001, 001, 071, 005, 003 },
+    ['8'] = { 032, 045, 045, 045, 032 },
+    ['9'] = { 006, 051, 051, 051, 036 },
+    ['.'] = { 000, 000, 040, 000, 000 },
+    [','] = { 000, 040, 020, 000, 000 },
+    ['/'] = { 040, 020, 014, 002, 001 },
+    ['-'] = { 010, 010, 010, 010, 000 },
+    ['+'] = { 010, 010, 076, 010, 010 },
+    ['='] = { 014, 014, 014, 014, 014 },
+    ['('] = { 000, 000, 036, 041, 000 },
+    [')'] = { 000, 041, 036, 000, 000 },
+    ['['] = { 000, 077, 041, 041, 000 },
+    [']'] = { 000, 041, 041, 077, 000 },
+    ['\''] = { 000, 000, 003, 000, 000 },
+    ['"'] = { 000, 003, 000, 003, 000 },
+    [':'] = { 000, 000, 022, 000, 000 },
+    [';'] = { 000, 040, 022, 000, 000 },
+    ['?'] = { 002, 001, 051, 005, 002 },
+    ['!'] = { 000, 000, 057, 000, 000 },
+    ['#'] = { 022, 077, 022, 077, 022 },
+    ['%'] = { 043, 023, 014, 062, 061 },
+    ['&'] = { 032, 045, 055, 022, 050 },
+    ['<'] = { 000, 014, 022, 041, 000 },
+    ['>'] = { 000, 041, 022, 014, 000 },
+    ['_'] = { 040, 040, 040, 040, 040 },
+    ['|'] = { 000, 000, 077, 000, 000 },
+    ['~'] = { 010, 004, 010, 020, 010 },
+    ['{'] = { 000, 014, 022, 041, 041 },
+    ['}'] = { 041, 041, 022, 014, 000 },
+    ['@'] = { 076, 001, 035, 025, 036 },
+};
+
+int glyph_defined(int c) {
+    if (c == ' ') return 1;
+    for (int i = 0; i < GLYPH_WIDTH; i++) {
+        if (FONT[c][i]) return 1;
+    }
+    return 0;
+}
+
+// render text into frames, returns the number of frames written
+size_t render_text(const char *text, uint8_t *frames) {
+    size_t n = 0;
+
+    for (const char *p = text; *p; p++) {
+        int c = (unsigned char)*p;
+        if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+        if (c < 128) c = toupper(c);
+
+        if (c >= 128 || !glyph_defined(c)) {
+            fprintf(stderr, "WARNING: no glyph for character %03o, leaving a blank cell\n", c);
+            c = ' ';
+        }
+
+        memcpy(frames + n, FONT[c], GLYPH_WIDTH);
+        frames[n + GLYPH_WIDTH] = 0;
+        n += CELL_WIDTH;
+    }
+
+    return n;
+}
+
+int read_macro_title(const char *path, char *text, size_t size) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "could not open file %s\n", path);
+        return 1;
+    }
+    if (!fgets(text, (int)size, fp)) text[0] = '\0';
+    fclose(fp);
+
+    text[strcspn(text, "\r\n")] = '\0';
+
+    // MACRO starts punching at the first non-blank character, the leading blank frames come from -l
+    size_t skip = strspn(text, " \t");
+    memmove(text, text + skip, strlen(text + skip) + 1);
+    return 0;
+}
+
+void print_preview(FILE *fp, const uint8_t *frames, size_t length) {
+    for (int y = 0; y < FRAME_HEIGHT; y++) {
+        for (size_t x = 0; x < length; x++) {
+            fputc((frames[x] >> y) & 1 ? '#' : '.', fp);
+        }
+        fputc('\n', fp);
+    }
+}
+
+static void put_le16(FILE *fp, uint16_t v) {
+    fputc(v & 0xff, fp);
+    fputc(v >> 8, fp);
+}
+
+static void put_le32(FILE *fp, uint32_t v) {
+    put_le16(fp, v & 0xffff);
+    put_le16(fp, v >> 16);
+}
+
+// 1-bit BMP, palette index 0 white and 1 black, so a punched hole (bit 1) is a black pixel as imgbin.py expects
+int write_bmp(const char *path, const uint8_t *frames, size_t length) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "could not open file %s\n", path);
+        return 1;
+    }
+
+    uint32_t row_size = (uint32_t)((length + 31) / 32 * 4);
+    uint32_t image_size = row_size * FRAME_HEIGHT;
+    uint32_t data_offset = 14 + 40 + 8;
+
+    fputs("BM", fp);
+    put_le32(fp, data_offset + image_size);
+    put_le32(fp, 0);
+    put_le32(fp, data_offset);
+
+    put_le32(fp, 40);
+    put_le32(fp, (uint32_t)length);
+    put_le32(fp, FRAME_HEIGHT);
+    put_le16(fp, 1);
+    put_le16(fp, 1);
+    put_le32(fp, 0);
+    put_le32(fp, image_size);
+    put_le32(fp, 2835);
+    put_le32(fp, 2835);
+    put_le32(fp, 2);
+    put_le32(fp, 2);
+
+    put_le32(fp, 0x00ffffff);
+    put_le32(fp, 0x00000000);
+
+    uint8_t *row = calloc(row_size, 1);
+    if (!row) {
+        fprintf(stderr, "could not allocate %u bytes for BMP row\n", row_size);
+        fclose(fp);
+        return 1;
+    }
+
+    // rows are stored bottom up
+    for (int y = FRAME_HEIGHT - 1; y >= 0; y--) {
+        memset(row, 0, row_size);
+        for (size_t x = 0; x < length; x++) {
+            if ((frames[x] >> y) & 1) row[x / 8] |= 0x80 >> (x % 8);
+        }
+        fwrite(row, 1, row_size, fp);
+    }
+
+    free(row);
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *macro_path = NULL;
+    const char *out_path = "title.bin";
+    const char *bmp_path = NULL;
+    long leading = DEFAULT_LEADING_FRAMES;
+    long total = -1;
+    char text[MAX_TEXT_LENGTH] = "";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:o:p:l:L:")) != -1) {
+        switch (opt) {
+            case 'm': macro_path = optarg; break;
+            case 'o': out_path = optarg; break;
+            case 'p': bmp_path = optarg; break;
+            case 'l': leading = atol(optarg); break;
+            case 'L': total = atol(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-m <MACRO source>] [-o <output file>] [-p <preview BMP>] [-l <leading frames>] [-L <total frames>] [text]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (macro_path) {
+        if (read_macro_title(macro_path, text, sizeof(text))) return 1;
+    }
+    for (int i = optind; i < argc; i++) {
+        if (strlen(text) + strlen(argv[i]) + 2 > sizeof(text)) {
+            fprintf(stderr, "text is longer than %d characters\n", MAX_TEXT_LENGTH - 1);
+            return 1;
+        }
+        if (text[0]) strcat(text, " ");
+        strcat(text, argv[i]);
+    }
+
+    if (!text[0]) {
+        fprintf(stderr, "Usage: %s [-m <MACRO source>] [-o <output file>] [-p <preview BMP>] [-l <leading frames>] [-L <total frames>] [text]\n", argv[0]);
+        return 1;
+    }
+    if (leading < 0) leading = 0;
+
+    size_t text_frames = strlen(text) * CELL_WIDTH;
+    size_t length = (size_t)leading + text_frames;
+    if (total >= 0 && (size_t)total < length) {
+        fprintf(stderr, "text needs %zu frames, more than the %ld allowed by -L\n", length, total);
+        return 1;
+    }
+    if (total >= 0) length = (size_t)total;
+
+    uint8_t *frames = calloc(length ? length : 1, 1);
+    if (!frames) {
+        fprintf(stderr, "could not allocate %zu frames\n", length);
+        return 1;
+    }
+    render_text(text, frames + leading);
+
+    FILE *fp;
+    int to_stdout = strcmp(out_path, "-") == 0;
+    if (to_stdout) {
+        fp = stdout;
+    } else {
+        fp = fopen(out_path, "wb");
+        if (!fp) {
+            fprintf(stderr, "could not open file %s\n", out_path);
+            return 1;
+        }
+    }
+
+    if (fwrite(frames, 1, length, fp) != length) {
+        fprintf(stderr, "could not write %s\n", out_path);
+        return 1;
+    }
+    if (!to_stdout) fclose(fp);
+
+    if (bmp_path && write_bmp(bmp_path, frames, length)) return 1;
+
+    print_preview(to_stdout ? stderr : stdout, frames + leading, length - leading);
+    if (!to_stdout) printf("%s: %zu frames (%ld leading, %zu text)\n", out_path, length, leading, text_frames);
+
+    free(frames);
+    return 0;
+}
@@ -3,6 +3,7 @@
  *
  * This program modifies a Harmony Compiler intermediate binary paper tape image to change inter-voice gaps and/or tempo
  * Usage: ./tweak <input file> (use '-' for stdin) <output file> (use '-' for stdout) <tempo> <gap length> (default: 18)
+ *        add --stats (to stderr) or --stats=<file> for the run's metrics as JSON
  * 
  * MIT License:
  * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
@@ -31,6 +32,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "../common/hcstats.h"
+
 // On 2024-01-05 Peter Samson mentioned the CHM PDP-1 CPU runs 6% slower than spec
 #define NOTES_BUFFER_SIZE 8192
 
@@ -46,6 +49,8 @@ uint32_t rpb(FILE *fp, uint32_t *gap_frames, uint32_t *inner_frames) {
 
     for (int i = 0; i < 3;) {
         if ((c = fgetc(fp)) == EOF) return EOF;
+        HC_COUNT(bytes_read, 1);
+        HC_COUNT(frames_read, 1);
 
         if (c & 0200) {
             // rbp skips lines without the 8th bit set, ignores 7th bit
@@ -56,10 +61,12 @@ uint32_t rpb(FILE *fp, uint32_t *gap_frames, uint32_t *inner_frames) {
                 (*inner_frames)++;
             } else {
                 (*gap_frames)++;
+                HC_COUNT(gap_frames, 1);
             }
         }
     }
 
+    HC_COUNT(words_read, 1);
     return word;
 }
 
@@ -67,6 +74,9 @@ void ppb(FILE *fp, uint32_t word) {
     putc(0200 | ((word & 0770000) >> 12), fp);
     putc(0200 | ((word & 0007700) >> 6), fp);
     putc(0200 | ((word & 0000077)), fp);
+    HC_COUNT(bytes_written, 3);
+    HC_COUNT(frames_written, 3);
+    HC_COUNT(words_written, 1);
 }
 
 uint32_t read_next_word(FILE *fp, uint32_t *word, uint32_t *word_count, uint32_t *gap_frames, uint8_t peek) {
@@ -110,8 +120,10 @@ uint32_t peek_gap(FILE *fp, uint32_t *gap_frames) {
         return EOF;
     }
 
-    // read the next word to get the gap frames
+    // read the next word to get the gap frames, it's read again for real later so isn't counted now
+    hc_counters_t counts = hc_stats.counts;
     word = rpb(fp, gap_frames, &inner_frames);
+    hc_stats.counts = counts;
 
     // restore the file position
     if (fseek(fp, current_pos, SEEK_SET) != 0) {
@@ -124,6 +136,7 @@ uint32_t peek_gap(FILE *fp, uint32_t *gap_frames) {
 
 uint32_t add_1s_complement(uint32_t a, uint32_t b) {
     uint32_t sum = a + b;
+    HC_COUNT(checksum_ops, 1);
     // add the carry to the sum and mask off potential overflow
     return ((sum & 0777777) + (sum >> 18)) & 0777777;
 }
@@ -243,11 +256,15 @@ void write_gap(FILE *fp_out, int length) {
     for (int i = 0; i < length; i++) {
         fputc(0, fp_out);
     }
+    HC_COUNT(bytes_written, length);
+    HC_COUNT(frames_written, length);
 }
 
 int main(int argc, char *argv[]) {
+    hc_stats_init("tweak", &argc, argv);
+
     if (argc < 3 || argc > 5) {
-        fprintf(stderr, "Usage: %s <input file> (use '-' for stdin) <output file> (use '-' for stdout) <tempo> <gap length> (default: 18)\n", argv[0]);
+        fprintf(stderr, "Usage: %s <input file> (use '-' for stdin) <output file> (use '-' for stdout) <tempo> <gap length> (default: 18) [--stats[=<file>]]\n", argv[0]);
         return 1;
     }
 
@@ -296,6 +313,7 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    hc_stats_phase("leader");
     printf("[leader: %d frames]\n", gap_frames_in);
     write_gap(fp_out, gap_frames_in);
 
@@ -305,11 +323,13 @@ int main(int argc, char *argv[]) {
         printf("║   VOICE %d   ║\n", voice);
         printf("╚═════════════╝\n");
 
+        hc_stats_phase("notes");
         if (copy_notes(fp_in, fp_out, tempo) == EOF) {
             perror("EOF in notes section\n");
             return 1;
         }
 
+        hc_stats_phase("bars");
         uint32_t inner_gap_length;
         if (peek_gap(fp_in, &inner_gap_length) == EOF) {
             perror("missing bars\n");
@@ -328,18 +348,25 @@ int main(int argc, char *argv[]) {
         voice++;
     }
 
+    hc_stats_phase("trailer");
     uint32_t trailer_length;
     if (peek_gap(fp_in, &trailer_length) != EOF) {
         perror("unexpected data after voice 4\n");
         return 1;
     }
 
+    // the trailer is only ever peeked, so count it here
+    HC_COUNT(bytes_read, trailer_length);
+    HC_COUNT(frames_read, trailer_length);
+    HC_COUNT(gap_frames, trailer_length);
+
     write_gap(fp_out, trailer_length);
     printf("trailer: %d frames\n", trailer_length);
 
     free(notes);
     if (strcmp(argv[1], "-")) fclose(fp_in);
     if (strcmp(argv[2], "-")) fclose(fp_out);
-    
+
+    hc_stats.complete = 1;
     return 0;
 }
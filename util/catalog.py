@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""
+catalog.py - compile a catalog of songs in parallel.
+
+hc_binmaker/update.sh compiles one song with fixed file names.  This compiles
+every song in a catalog at once, one emulator per core, each job with its own
+working files under the output directory:
+
+    <out>/<song>/<song>.fio    FIODEC source, the song's voices merged as util/merge.py does
+    <out>/<song>/<song>.bin    intermediate tape
+    <out>/<song>/hc1_log.txt   emulator console log
+    <out>/<song>/job.log       every attempt, with its time and any error
+
+Compiles go through util/hccompile.py, so unchanged songs are cache hits and
+each emulator runs in a private directory.  A failed or timed out compile is
+retried, and the tape must checksum and hold one voice per source file to
+count as built.  A summary of every job is printed at the end, and the exit
+status is 1 if any song failed.
+
+A catalog is a text file with one song per line: a name, then its voice
+sources in tape order, relative to the catalog file.  Blank lines and lines
+starting with # are ignored.
+
+    boc-olson voices/melody.txt voices/bass2.txt voices/bass1.txt voices/bass0.txt
+
+Usage
+-----
+    python3 util/catalog.py [--jobs N] [--retries N] [--timeout S] [--out DIR] [--no-cache] <catalog.txt> [song ...]
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+from dataclasses import dataclass, field
+from pathlib import Path
+
+import hccompile
+
+ROOT = Path(__file__).resolve().parent.parent
+TAPE_END = "\n@"            # voice terminator, as in util/merge.py
+
+
+@dataclass
+class Song:
+    name: str
+    voices: list[Path]
+
+
+@dataclass
+class Result:
+    song: Song
+    status: str = "failed"  # built, cached or failed
+    attempts: int = 0
+    seconds: float = 0.0
+    tape_bytes: int = 0
+    error: str = ""
+    log: list[str] = field(default_factory=list)
+
+
+def read_catalog(path: Path) -> list[Song]:
+    songs = []
+    for number, line in enumerate(path.read_text(encoding="utf-8").splitlines(), 1):
+        fields = line.split()
+        if not fields or fields[0].startswith("#"):
+            continue
+        if len(fields) < 2:
+            raise SystemExit(f"{path}:{number}: song {fields[0]!r} has no voices")
+        songs.append(Song(fields[0], [path.parent / voice for voice in fields[1:]]))
+    names = [song.name for song in songs]
+    duplicates = sorted({name for name in names if names.count(name) > 1})
+    if duplicates:
+        raise SystemExit(f"{path}: duplicate songs: {', '.join(duplicates)}")
+    return songs
+
+
+def tape_voices(tape: bytes) -> int:
+    """Voices on an intermediate tape, checking every part's checksum as rpb would read it."""
+    words = []
+    word = frames = 0
+    for c in tape:
+        if not c & 0o200:
+            if frames:
+                raise ValueError("blank frame inside a word")
+            continue
+        word = (word << 6) | (c & 0o77)
+        frames += 1
+        if frames == 3:
+            words.append(word & 0o777777)
+            word = frames = 0
+    if frames:
+        raise ValueError("tape ends inside a word")
+
+    parts = pos = 0
+    while pos < len(words):
+        count = words[pos]
+        if pos + count + 2 > len(words):
+            raise ValueError(f"part {parts + 1} is cut short")
+        checksum = 0
+        for data in words[pos + 1:pos + 1 + count]:
+            checksum += data
+            checksum = (checksum & 0o777777) + (checksum >> 18)
+        if checksum != words[pos + 1 + count]:
+            raise ValueError(f"part {parts + 1} checksum mismatch")
+        pos += count + 2
+        parts += 1
+    if parts % 2:
+        raise ValueError("notes part without its bars part")
+    return parts // 2
+
+
+def build_song(song: Song, out: Path, retries: int, timeout: float | None, use_cache: bool) -> Result:
+    result = Result(song)
+    workdir = out / song.name
+    workdir.mkdir(parents=True, exist_ok=True)
+    fio = workdir / f"{song.name}.fio"
+    tape = workdir / f"{song.name}.bin"
+    start = time.perf_counter()
+
+    try:
+        source = TAPE_END.join(voice.read_text(encoding="utf-8") for voice in song.voices) + TAPE_END
+        proc = subprocess.run([str(ROOT / "hc_binmaker/ascii2fiodec"), "-f"], input=source.encode("utf-8"),
+                              stdout=subprocess.PIPE, stderr=subprocess.PIPE, check=True)
+        fio.write_bytes(proc.stdout)
+    except (OSError, subprocess.CalledProcessError) as exc:
+        result.error = f"source: {exc}"
+        result.log.append(result.error)
+
+    while not result.error and result.attempts <= retries:
+        result.attempts += 1
+        attempt_start = time.perf_counter()
+        try:
+            hit = hccompile.compile_fio(fio, tape, workdir / "hc1_log.txt", voices=len(song.voices),
+                                        use_cache=use_cache, timeout=timeout)
+            voices = tape_voices(tape.read_bytes())
+            if voices != len(song.voices):
+                raise ValueError(f"tape has {voices} voices, expected {len(song.voices)}")
+        except subprocess.TimeoutExpired:
+            error = f"timed out after {timeout:g} s"
+        except (OSError, RuntimeError, ValueError) as exc:
+            error = str(exc).strip().splitlines()[0] if str(exc).strip() else type(exc).__name__
+        else:
+            result.status = "cached" if hit else "built"
+            result.tape_bytes = tape.stat().st_size
+            result.log.append(f"attempt {result.attempts}: {result.status} "
+                              f"({(time.perf_counter() - attempt_start) * 1000:.0f} ms)")
+            break
+        result.log.append(f"attempt {result.attempts}: {error} ({(time.perf_counter() - attempt_start) * 1000:.0f} ms)")
+        result.error = error if result.attempts > retries else ""
+
+    result.seconds = time.perf_counter() - start
+    (workdir / "job.log").write_text("".join(line + "\n" for line in result.log), encoding="utf-8")
+    return result
+
+
+def summarize(results: list[Result], wall: float, jobs: int) -> None:
+    width = max(len(result.song.name) for result in results)
+    print(f"\n{'song':<{width}}  {'status':<7} {'tries':>5} {'ms':>7} {'bytes':>8}")
+    for result in sorted(results, key=lambda r: r.song.name):
+        print(f"{result.song.name:<{width}}  {result.status:<7} {result.attempts:>5} "
+              f"{result.seconds * 1000:>7.0f} {result.tape_bytes:>8}"
+              + (f"  {result.error}" if result.status == "failed" else ""))
+
+    counts = {status: sum(1 for r in results if r.status == status) for status in ("built", "cached", "failed")}
+    busy = sum(result.seconds for result in results)
+    print(f"\n{len(results)} songs: {counts['built']} built, {counts['cached']} cached, {counts['failed']} failed; "
+          f"{wall:.2f} s wall, {busy:.2f} s of jobs on {jobs} worker{'s' if jobs > 1 else ''} "
+          f"({busy / wall if wall else 0:.1f}x)")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Compile a catalog of songs in parallel.")
+    parser.add_argument("catalog", type=Path, help="catalog file, one song per line: name voice.txt...")
+    parser.add_argument("songs", nargs="*", help="songs to build (default: all)")
+    parser.add_argument("--jobs", "-j", type=int, default=os.cpu_count() or 1, help="emulators to run at once")
+    parser.add_argument("--retries", type=int, default=1, help="extra attempts for a failed compile (default: 1)")
+    parser.add_argument("--timeout", type=float, default=300, help="seconds to allow each compile (default: 300)")
+    parser.add_argument("--out", "-o", type=Path, default=ROOT / "output/catalog", help="directory for job files")
+    parser.add_argument("--no-cache", action="store_true", help="always run the emulator")
+    args = parser.parse_args()
+
+    songs = read_catalog(args.catalog)
+    if args.songs:
+        unknown = sorted(set(args.songs) - {song.name for song in songs})
+        if unknown:
+            parser.error(f"not in {args.catalog}: {', '.join(unknown)}")
+        songs = [song for song in songs if song.name in args.songs]
+    if not songs:
+        parser.error("no songs to build")
+
+    jobs = max(1, min(args.jobs, len(songs)))
+    start = time.perf_counter()
+    results = []
+    with ThreadPoolExecutor(max_workers=jobs) as pool:
+        futures = [pool.submit(build_song, song, args.out, args.retries, args.timeout, not args.no_cache)
+                   for song in songs]
+        for future in as_completed(futures):
+            result = future.result()
+            results.append(result)
+            print(f"[{result.song.name}] {result.status}"
+                  + (f": {result.error}" if result.status == "failed" else f" ({result.seconds * 1000:.0f} ms)"))
+    summarize(results, time.perf_counter() - start, jobs)
+
+    if any(result.status == "failed" for result in results):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+hccompile.py - run the Harmony Compiler in the emulator, with a result cache.
+
+The 1962 compiler is deterministic: the same FIODEC source, compiler image
+(hc_binmaker/hc1c.rim), emulator binary and emulator settings always punch
+the same intermediate tape.  So results are stored under a hash of those
+inputs, and a recompile of an unchanged source is a hash and a copy.
+
+Each compile runs in its own temporary directory, so any number can run at
+once, and a cache entry is written to a temporary directory inside the cache
+and renamed into place, so readers never see a partial entry and concurrent
+writers of the same entry don't clash (the first rename wins, and both
+results are the same anyway).
+
+The cache lives in .hccache/ at the repo root, or $HC_CACHE_DIR.  It is safe
+to delete at any time.
+
+Usage
+-----
+    python3 util/hccompile.py [--voices N] [--no-cache] [--timeout S] <in.fio> <out.bin> [<log.txt>]
+"""
+
+from __future__ import annotations
+
+import argparse
+import hashlib
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+HC_DIR = ROOT / "hc_binmaker"
+CACHE_DIR = Path(os.environ.get("HC_CACHE_DIR", ROOT / ".hccache"))
+CACHE_VERSION = b"hccompile 1"
+SOURCE_NAME = "boc-olson.fio"      # names hc1-4.ini attaches, inside each compile's own directory
+TAPE_NAME = "boc-olson.bin"
+LOG_NAME = "hc1_log.txt"
+DEFAULT_VOICES = 4
+
+
+def settings(voices: int) -> bytes:
+    """hc1-4.ini, with one cont per voice (the compiler halts after punching each voice)."""
+    ini = (HC_DIR / "hc1-4.ini").read_bytes()
+    return re.sub(rb"(?:cont\r?\n)+", b"cont\r\n" * voices, ini)
+
+
+def cache_key(source: bytes, ini: bytes) -> str:
+    """Hash of everything that determines the compiled tape."""
+    digest = hashlib.sha256(CACHE_VERSION)
+    for part in (source, ini, (HC_DIR / "hc1c.rim").read_bytes(), (HC_DIR / "pdp1").read_bytes()):
+        digest.update(len(part).to_bytes(8, "little"))
+        digest.update(part)
+    return digest.hexdigest()
+
+
+def copy_atomic(src: Path, dst: Path) -> None:
+    """Copy so dst is never seen half written."""
+    tmp = dst.with_name(f".{dst.name}.{os.getpid()}.tmp")
+    shutil.copyfile(src, tmp)
+    os.replace(tmp, dst)
+
+
+def run_compiler(source: bytes, ini: bytes, workdir: Path, timeout: float | None) -> None:
+    """Compile source to workdir/TAPE_NAME, with the console log in workdir/LOG_NAME."""
+    (workdir / SOURCE_NAME).write_bytes(source)
+    (workdir / "hc1-4.ini").write_bytes(ini)
+    shutil.copyfile(HC_DIR / "hc1c.rim", workdir / "hc1c.rim")
+    proc = subprocess.run(
+        [str(HC_DIR / "pdp1"), "hc1-4.ini"], cwd=workdir, stdin=subprocess.DEVNULL,
+        stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=timeout,
+    )
+    if proc.returncode != 0 or not (workdir / TAPE_NAME).is_file():
+        raise RuntimeError(f"pdp1 exited with {proc.returncode}\n" + proc.stdout.decode(errors="replace"))
+
+
+def store(key: str, workdir: Path) -> None:
+    """Add a compile's tape and log to the cache, unless another build got there first."""
+    entry = CACHE_DIR / key[:2] / key
+    if entry.is_dir():
+        return
+    entry.parent.mkdir(parents=True, exist_ok=True)
+    tmp = Path(tempfile.mkdtemp(prefix=".tmp-", dir=entry.parent))
+    try:
+        shutil.copyfile(workdir / TAPE_NAME, tmp / TAPE_NAME)
+        shutil.copyfile(workdir / LOG_NAME, tmp / LOG_NAME)
+        os.rename(tmp, entry)
+    except OSError:
+        if not entry.is_dir():
+            raise
+    finally:
+        shutil.rmtree(tmp, ignore_errors=True)
+
+
+def compile_fio(fio: Path, tape: Path, log: Path | None = None, voices: int = DEFAULT_VOICES,
+                use_cache: bool = True, timeout: float | None = None) -> bool:
+    """Compile a FIODEC source to an intermediate tape (and console log). Returns True on a cache hit."""
+    source = Path(fio).read_bytes()
+    ini = settings(voices)
+    key = cache_key(source, ini)
+    entry = CACHE_DIR / key[:2] / key
+
+    if use_cache and entry.is_dir():
+        copy_atomic(entry / TAPE_NAME, Path(tape))
+        if log:
+            copy_atomic(entry / LOG_NAME, Path(log))
+        return True
+
+    with tempfile.TemporaryDirectory(prefix="hccompile-") as workdir:
+        workdir = Path(workdir)
+        run_compiler(source, ini, workdir, timeout)
+        if use_cache:
+            store(key, workdir)
+        copy_atomic(workdir / TAPE_NAME, Path(tape))
+        if log:
+            copy_atomic(workdir / LOG_NAME, Path(log))
+    return False
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Compile a FIODEC Harmony Compiler source in the emulator, cached.")
+    parser.add_argument("fio", type=Path, help="FIODEC source, as written by ascii2fiodec -f")
+    parser.add_argument("tape", type=Path, help="intermediate tape to write")
+    parser.add_argument("log", type=Path, nargs="?", help="emulator console log to write")
+    parser.add_argument("--voices", type=int, default=DEFAULT_VOICES, help="voices in the source (default: 4)")
+    parser.add_argument("--no-cache", action="store_true", help="always run the emulator, and don't store the result")
+    parser.add_argument("--timeout", type=float, default=None, help="seconds to allow the emulator")
+    args = parser.parse_args()
+
+    try:
+        hit = compile_fio(args.fio, args.tape, args.log, args.voices, not args.no_cache, args.timeout)
+    except (RuntimeError, subprocess.TimeoutExpired) as exc:
+        sys.exit(f"{args.fio}: {exc}")
+    print(f"{args.tape}: {'cache hit' if hit else 'compiled'}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
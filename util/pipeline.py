@@ -0,0 +1,479 @@
+#!/usr/bin/env python3
+"""
+pipeline.py - incremental build driver for the music pipeline in WORKFLOW.md.
+
+Every stage declares the files it reads and writes.  A stage is skipped when
+the content hashes of its inputs (including the tool it runs) match the last
+successful run and its outputs are still as it left them, so a one-note edit
+only rebuilds what depends on it, and a stage whose output comes out unchanged
+stops the rebuild there.  Stages whose inputs are ready run in parallel, e.g.
+the leader and trailer conversions run alongside compilation.
+
+With --watch the driver stays resident: it builds once, then waits on inotify
+for saves to the voices, simulator scores, title.mac or the leader/trailer
+BMPs, and rebuilds after each one, publishing output/boc-olson.bin, its SVG
+and a preview WAV.  It keeps the file hashes and the Python tools (Pillow
+included) loaded between builds, and reports each stage's time and the total
+from save to fresh tape.  Without inotify (e.g. macOS) it polls instead.
+
+Usage
+-----
+    python3 util/pipeline.py [--jobs N] [--force] [--dry-run] [--leader bmp|mac] [--watch] [stage ...]
+
+With no stage names, everything is built.  Naming stages builds them and the
+stages they depend on.  Run ./build.sh first to build the tools.
+"""
+
+from __future__ import annotations
+
+import argparse
+import hashlib
+import json
+import ctypes
+import ctypes.util
+import os
+import re
+import runpy
+import select
+import struct
+import subprocess
+import sys
+import threading
+import time
+from concurrent.futures import FIRST_COMPLETED, ThreadPoolExecutor, wait
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Callable
+
+import hccompile
+
+ROOT = Path(__file__).resolve().parent.parent
+STATE_PATH = ROOT / ".pipeline-state.json"
+VOICES = ["melody", "bass2", "bass1", "bass0"]   # tape order, as in util/merge.py
+COMPILE_TIMEOUT = 300                            # seconds
+WATCHED = {                                      # directory: file names whose saves trigger a rebuild
+    "voices": {f"{voice}.txt" for voice in VOICES},
+    "simulator/scores": None,                    # any .txt
+    "title": {"title.mac"},
+    "imgbin": {"title.bmp", "trailer.bmp"},
+}
+SCORE_NOTE = re.compile(r"[a-gA-GrR][#b]?\d*t(\d+)")  # "{note}t{duration}", as playback-processor.js parses
+DEBOUNCE = 0.05                                  # seconds to wait for the rest of an editor's writes
+
+# run Python stages inside this process rather than starting an interpreter each time, set by --watch
+in_process = False
+script_lock = threading.Lock()
+
+
+@dataclass
+class Stage:
+    name: str
+    inputs: list[str]                 # repo-relative paths read, tools included
+    outputs: list[str]                # repo-relative paths written
+    run: Callable[[], None]
+    deps: set[str] = field(default_factory=set)
+
+
+def sh(cmd: list[str], cwd: str = ".", stdout_path: str | None = None, timeout: float | None = None) -> None:
+    """Run a command from a repo-relative directory, optionally capturing stdout to a repo-relative file."""
+    out = open(ROOT / stdout_path, "wb") if stdout_path else subprocess.PIPE
+    try:
+        proc = subprocess.run(
+            cmd, cwd=ROOT / cwd, stdin=subprocess.DEVNULL, stdout=out,
+            stderr=subprocess.PIPE, timeout=timeout,
+        )
+    finally:
+        if stdout_path:
+            out.close()
+    if proc.returncode != 0:
+        raise RuntimeError(
+            f"{' '.join(cmd)} exited with {proc.returncode}\n"
+            + (proc.stdout or b"").decode(errors="replace")
+            + proc.stderr.decode(errors="replace")
+        )
+
+
+def script(path: str, *args: str) -> None:
+    """Run a repo-relative Python script, in this process when in_process is set."""
+    if not in_process:
+        sh([sys.executable, path, *args])
+        return
+
+    # sys.argv is process-wide, so in-process scripts take turns
+    with script_lock:
+        saved = sys.argv
+        sys.argv = [path, *args]
+        try:
+            runpy.run_path(str(ROOT / path), run_name="__main__")
+        except SystemExit as exc:
+            if exc.code not in (None, 0):
+                raise RuntimeError(f"{path} exited with {exc.code}") from None
+        finally:
+            sys.argv = saved
+
+
+def check_scores() -> None:
+    """Check every measure of the simulator scores adds up to a whole note, the way playback-processor.js reads them."""
+    problems = []
+    for path in sorted((ROOT / "simulator/scores").glob("*.txt")):
+        for number, line in enumerate(path.read_text(encoding="utf-8").splitlines(), 1):
+            fields = line.split()
+            if not fields or not fields[0].isdigit():
+                continue
+            durations = [int(note.group(1)) for f in fields[1:] if (note := SCORE_NOTE.fullmatch(f))]
+            length = sum(1 / d for d in durations if d)
+            if abs(length - 1) > 1e-9:
+                problems.append(f"{path.name}:{number}: measure {fields[0]} is {length:g} whole notes")
+    (ROOT / "output/scores-check.txt").write_text("".join(p + "\n" for p in problems) or "ok\n")
+    if problems:
+        raise RuntimeError("\n".join(problems))
+
+
+def compile_voice(voice: str) -> None:
+    """Compile one voice on its own, through the compile cache, to hc_binmaker/parts/<voice>.bin."""
+    parts = ROOT / "hc_binmaker/parts"
+    parts.mkdir(exist_ok=True)
+    # a one-voice source, terminated as util/merge.py terminates each voice
+    source = (ROOT / f"voices/{voice}.txt").read_text(encoding="utf-8") + "\n@"
+    proc = subprocess.run([str(ROOT / "hc_binmaker/ascii2fiodec"), "-f"], input=source.encode("utf-8"),
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if proc.returncode != 0:
+        raise RuntimeError(f"ascii2fiodec exited with {proc.returncode}\n" + proc.stderr.decode(errors="replace"))
+    (parts / f"{voice}.fio").write_bytes(proc.stdout)
+    hit = hccompile.compile_fio(parts / f"{voice}.fio", parts / f"{voice}.bin", parts / f"{voice}.log",
+                                voices=1, timeout=COMPILE_TIMEOUT)
+    if hit:
+        print(f"[voice-{voice}] cache hit")
+
+
+def stages(leader: str) -> list[Stage]:
+    """The WORKFLOW.md steps 2-5 as stages."""
+    score_sources = sorted(str(path.relative_to(ROOT)) for path in (ROOT / "simulator/scores").glob("*.txt"))
+
+    # each voice compiles on its own, so an edit recompiles only that voice, and the compiled voices are spliced
+    # into the same tape hc_binmaker/update.sh compiles from the merged source
+    result = [
+        Stage(f"voice-{voice}",
+              [f"voices/{voice}.txt", "hc_binmaker/ascii2fiodec", "util/hccompile.py", "hc_binmaker/pdp1",
+               "hc_binmaker/hc1-4.ini", "hc_binmaker/hc1c.rim"],
+              [f"hc_binmaker/parts/{voice}.fio", f"hc_binmaker/parts/{voice}.bin", f"hc_binmaker/parts/{voice}.log"],
+              lambda voice=voice: compile_voice(voice))
+        for voice in VOICES
+    ]
+    voice_tapes = [f"hc_binmaker/parts/{voice}.bin" for voice in VOICES]
+    result += [
+        Stage("compile", ["hc_binmaker/splice", *voice_tapes], ["hc_binmaker/boc-olson.bin"],
+              lambda: sh(["hc_binmaker/splice", "-o", "hc_binmaker/boc-olson.bin", *voice_tapes])),
+        Stage("verify", ["verify/decodehcint", "hc_binmaker/boc-olson.bin"], ["output/boc-olson-decoded.txt"],
+              lambda: sh(["verify/decodehcint", "hc_binmaker/boc-olson.bin"], stdout_path="output/boc-olson-decoded.txt")),
+        Stage("tweak", ["tweak/tweak", "hc_binmaker/boc-olson.bin"], ["output/boc-olson-full.bin"],
+              lambda: sh(["tweak/tweak", "hc_binmaker/boc-olson.bin", "output/boc-olson-full.bin"])),
+        Stage("trailer", ["imgbin/imgbin.py", "imgbin/trailer.bmp"], ["imgbin/trailer.bin"],
+              lambda: script("imgbin/imgbin.py", "imgbin/trailer.bmp", "imgbin/trailer.bin")),
+        Stage("scores", score_sources, ["output/scores-check.txt"], check_scores),
+    ]
+
+    if leader == "mac":
+        # render the title straight from title.mac, as tall as the leader tweak leaves
+        result.append(Stage("leader", ["title/banner", "title/title.mac"], ["imgbin/title.bin"],
+                            lambda: sh(["title/banner", "-m", "title/title.mac", "-L", "255", "-o", "imgbin/title.bin"])))
+    else:
+        result.append(Stage("leader", ["imgbin/imgbin.py", "imgbin/title.bmp"], ["imgbin/title.bin"],
+                            lambda: script("imgbin/imgbin.py", "imgbin/title.bmp", "imgbin/title.bin")))
+
+    result += [
+        Stage("replace",
+              ["title/replace.py", "imgbin/title.bin", "imgbin/trailer.bin", "output/boc-olson-full.bin"],
+              ["output/boc-olson.bin"],
+              lambda: script("title/replace.py", "--title", "imgbin/title.bin", "--trailer", "imgbin/trailer.bin",
+                             "--tape-in", "output/boc-olson-full.bin", "--tape-out", "output/boc-olson.bin")),
+        Stage("svg", ["verify/dumpsvg.py", "output/boc-olson.bin"], ["output/boc-olson.svg"],
+              lambda: script("verify/dumpsvg.py", "-o", "output/boc-olson.svg", "output/boc-olson.bin")),
+        # preview at the CHM machine's speed, as the simulator plays it
+        Stage("wav", ["render/render", "output/boc-olson.bin"], ["output/boc-olson.wav"],
+              lambda: sh(["render/render", "-c", "-o", "output/boc-olson.wav", "output/boc-olson.bin"])),
+    ]
+
+    # a stage depends on whichever stages write its inputs
+    producers = {out: stage.name for stage in result for out in stage.outputs}
+    for stage in result:
+        stage.deps = {producers[path] for path in stage.inputs if path in producers}
+    return result
+
+
+# path: ((st_ino, st_size, st_mtime_ns), sha256), so a resident driver only rereads files that changed
+hash_cache: dict[str, tuple[tuple[int, int, int], str]] = {}
+
+
+def file_hash(path: str) -> str | None:
+    """sha256 of a repo-relative file, or None if it doesn't exist."""
+    try:
+        st = os.stat(ROOT / path)
+    except FileNotFoundError:
+        return None
+    stamp = (st.st_ino, st.st_size, st.st_mtime_ns)
+    cached = hash_cache.get(path)
+    if cached and cached[0] == stamp:
+        return cached[1]
+
+    digest = hashlib.sha256()
+    try:
+        with open(ROOT / path, "rb") as f:
+            while chunk := f.read(1 << 20):
+                digest.update(chunk)
+    except FileNotFoundError:
+        return None
+    hash_cache[path] = (stamp, digest.hexdigest())
+    return digest.hexdigest()
+
+
+def stage_key(stage: Stage) -> str | None:
+    """Hash of everything a stage reads, or None when an input is missing."""
+    digest = hashlib.sha256(stage.name.encode())
+    for path in stage.inputs:
+        h = file_hash(path)
+        if h is None:
+            return None
+        digest.update(f"{path}\0{h}\0".encode())
+    return digest.hexdigest()
+
+
+class Pipeline:
+    def __init__(self, all_stages: list[Stage], jobs: int, force: bool, dry_run: bool, quiet: bool = False):
+        self.stages = {stage.name: stage for stage in all_stages}
+        self.jobs = jobs
+        self.quiet = quiet          # only report stages that ran
+        self.force = force
+        self.dry_run = dry_run
+        self.lock = threading.Lock()
+        try:
+            self.state = json.loads(STATE_PATH.read_text())
+        except (FileNotFoundError, json.JSONDecodeError):
+            self.state = {}
+
+    def save_state(self) -> None:
+        tmp = STATE_PATH.with_suffix(".tmp")
+        tmp.write_text(json.dumps(self.state, indent=2, sort_keys=True))
+        os.replace(tmp, STATE_PATH)
+
+    def up_to_date(self, stage: Stage, key: str) -> bool:
+        previous = self.state.get(stage.name)
+        if self.force or not previous or previous.get("key") != key:
+            return False
+        return all(file_hash(path) == h for path, h in previous.get("outputs", {}).items())
+
+    def run_stage(self, stage: Stage) -> tuple[str, float]:
+        """Run one stage if its inputs changed. Returns (status, seconds)."""
+        key = stage_key(stage)
+        if key is None:
+            missing = [path for path in stage.inputs if file_hash(path) is None]
+            raise RuntimeError(f"missing input{'s' if len(missing) > 1 else ''}: {', '.join(missing)}")
+        if self.up_to_date(stage, key):
+            return "up to date", 0.0
+        if self.dry_run:
+            return "would run", 0.0
+
+        start = time.perf_counter()
+        for path in stage.outputs:
+            # a rewrite within the timestamp granularity could otherwise look unchanged
+            hash_cache.pop(path, None)
+        stage.run()
+        elapsed = time.perf_counter() - start
+
+        with self.lock:
+            self.state[stage.name] = {"key": key, "outputs": {path: file_hash(path) for path in stage.outputs}}
+            self.save_state()
+        return "built", elapsed
+
+    def closure(self, targets: list[str]) -> set[str]:
+        """The named stages plus everything they depend on."""
+        needed: set[str] = set()
+        todo = list(targets or self.stages)
+        while todo:
+            name = todo.pop()
+            if name not in self.stages:
+                raise SystemExit(f"unknown stage {name!r}; stages: {', '.join(self.stages)}")
+            if name not in needed:
+                needed.add(name)
+                todo.extend(self.stages[name].deps)
+        return needed
+
+    def build(self, targets: list[str]) -> dict[str, tuple[str, float]]:
+        """Build targets, running ready stages in parallel. Returns status and seconds per stage."""
+        pending = self.closure(targets)
+        results: dict[str, tuple[str, float]] = {}
+        failed = False
+
+        with ThreadPoolExecutor(max_workers=self.jobs) as pool:
+            running = {}
+            while pending or running:
+                progress = True          # a failure only holds back the stages that depend on it
+                while progress:
+                    progress = False
+                    for name in sorted(pending):
+                        deps = self.stages[name].deps
+                        if not deps <= results.keys():
+                            continue
+                        pending.discard(name)
+                        progress = True
+                        if self.dry_run and any(results[dep][0] != "up to date" for dep in deps):
+                            # inputs would be rewritten upstream, so assume this stage would run too
+                            results[name] = ("would run", 0.0)
+                            print(f"[{name}] would run")
+                            continue
+                        running[pool.submit(self.run_stage, self.stages[name])] = name
+                if not running:
+                    break
+                done, _ = wait(running, return_when=FIRST_COMPLETED)
+                for future in done:
+                    name = running.pop(future)
+                    try:
+                        results[name] = future.result()
+                    except Exception as exc:  # report the stage, keep the others going
+                        print(f"[{name}] FAILED: {exc}", file=sys.stderr)
+                        failed = True
+                        continue
+                    status, seconds = results[name]
+                    if status != "up to date" or not self.quiet:
+                        print(f"[{name}] {status}" + (f" ({seconds * 1000:.0f} ms)" if status == "built" else ""))
+
+        if failed or pending:
+            skipped = sorted(pending)
+            if skipped:
+                print(f"not built: {', '.join(skipped)}", file=sys.stderr)
+            raise SystemExit(1)
+        return results
+
+
+class Watcher:
+    """Waits for saves to the WATCHED files, with inotify where there is one and by polling otherwise."""
+
+    IN_CLOSE_WRITE = 0x008
+    IN_MOVED_TO = 0x080
+    IN_CREATE = 0x100
+    IN_CLOEXEC = 0o2000000
+    POLL_INTERVAL = 0.2
+
+    def __init__(self):
+        self.fd = -1
+        self.dirs: dict[int, str] = {}
+        libc_name = ctypes.util.find_library("c")
+        libc = ctypes.CDLL(libc_name, use_errno=True) if libc_name else None
+        if libc is not None and hasattr(libc, "inotify_init1"):
+            self.fd = libc.inotify_init1(self.IN_CLOEXEC)
+        if self.fd >= 0:
+            mask = self.IN_CLOSE_WRITE | self.IN_MOVED_TO | self.IN_CREATE
+            for directory in WATCHED:
+                wd = libc.inotify_add_watch(self.fd, str(ROOT / directory).encode(), mask)
+                if wd < 0:
+                    raise OSError(ctypes.get_errno(), f"inotify_add_watch {directory}")
+                self.dirs[wd] = directory
+        self.stamps = self.scan()
+
+    @staticmethod
+    def watched(directory: str, name: str) -> bool:
+        names = WATCHED[directory]
+        return name in names if names is not None else name.endswith(".txt")
+
+    def scan(self) -> dict[str, tuple[int, int]]:
+        """(size, mtime) of every watched file, for polling."""
+        stamps = {}
+        for directory in WATCHED:
+            for entry in os.scandir(ROOT / directory):
+                if self.watched(directory, entry.name):
+                    st = entry.stat()
+                    stamps[f"{directory}/{entry.name}"] = (st.st_size, st.st_mtime_ns)
+        return stamps
+
+    def read_events(self, timeout: float | None) -> set[str]:
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return set()
+        data = os.read(self.fd, 65536)
+        changed = set()
+        offset = 0
+        while offset < len(data):
+            wd, _mask, _cookie, length = struct.unpack_from("iIII", data, offset)
+            name = data[offset + 16:offset + 16 + length].rstrip(b"\0").decode(errors="replace")
+            offset += 16 + length
+            directory = self.dirs.get(wd)
+            if directory and self.watched(directory, name):
+                changed.add(f"{directory}/{name}")
+        return changed
+
+    def wait(self) -> tuple[set[str], float]:
+        """Block until watched files change. Returns their paths and the perf_counter() time of the first save."""
+        if self.fd < 0:
+            while True:
+                time.sleep(self.POLL_INTERVAL)
+                stamps = self.scan()
+                changed = {path for path in stamps.keys() | self.stamps.keys()
+                           if stamps.get(path) != self.stamps.get(path)}
+                self.stamps = stamps
+                if changed:
+                    # the save happened somewhere in the last interval
+                    return changed, time.perf_counter() - self.POLL_INTERVAL / 2
+
+        changed: set[str] = set()
+        while not changed:
+            changed = self.read_events(None)
+        first = time.perf_counter()
+        # editors often save in several writes or a write and a rename, take them as one edit
+        while more := self.read_events(DEBOUNCE):
+            changed |= more
+        return changed, first
+
+
+def watch(pipeline: Pipeline, targets: list[str]) -> None:
+    global in_process
+    in_process = True
+    watcher = Watcher()
+    print(f"watching {', '.join(WATCHED)}" + ("" if watcher.fd >= 0 else " (polling)"))
+
+    def build(start: float) -> None:
+        try:
+            results = pipeline.build(targets)
+        except SystemExit:
+            print("build failed, waiting for the next save", file=sys.stderr)
+            return
+        built = [name for name, (status, _) in results.items() if status == "built"]
+        total = (time.perf_counter() - start) * 1000
+        print(f"{'rebuilt ' + ', '.join(built) if built else 'nothing to rebuild'} - save to tape {total:.0f} ms")
+
+    build(time.perf_counter())
+    pipeline.force = False          # --force only applies to the first build
+    while True:
+        changed, start = watcher.wait()
+        for path in changed:
+            hash_cache.pop(path, None)
+        print(f"changed: {', '.join(sorted(changed))}")
+        build(start)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Incrementally build the paper tape from the voice sources.")
+    parser.add_argument("stages", nargs="*", help="stages to build (default: all)")
+    parser.add_argument("--jobs", "-j", type=int, default=os.cpu_count() or 1, help="stages to run at once")
+    parser.add_argument("--force", "-f", action="store_true", help="rebuild even when inputs are unchanged")
+    parser.add_argument("--dry-run", "-n", action="store_true", help="only report what would be rebuilt")
+    parser.add_argument("--leader", choices=["bmp", "mac"], default="bmp",
+                        help="leader source: hand-edited imgbin/title.bmp (default) or title/title.mac via title/banner")
+    parser.add_argument("--watch", "-w", action="store_true", help="stay resident and rebuild on every save")
+    args = parser.parse_args()
+
+    if args.watch and args.dry_run:
+        parser.error("--watch and --dry-run don't mix")
+    pipeline = Pipeline(stages(args.leader), max(1, args.jobs), args.force, args.dry_run, quiet=args.watch)
+    if args.watch:
+        # in-process scripts resolve their paths from the repo root, like sh() does
+        os.chdir(ROOT)
+        try:
+            watch(pipeline, args.stages)
+        except KeyboardInterrupt:
+            pass
+        return
+    pipeline.build(args.stages)
+
+
+if __name__ == "__main__":
+    main()
@@ -2,7 +2,10 @@
  * decodehcint.c
  *
  * This program decodes a Harmony Compiler intermediate binary paper tape image.
- * Usage: ./decodehcint <file> (use '-' for stdin)
+ * Usage: ./decodehcint [-a] [-j threads] <file> (use '-' for stdin) [--stats[=<file>]]
+ *        -a decodes every voice rather than the first 4 (for concatenated tapes)
+ *        -j decodes that many voices at once (default: one per CPU), the output is the same either way
+ *        --stats writes the run's metrics as JSON, to stderr or a file
  * 
  * MIT License:
  * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
@@ -26,34 +29,65 @@
  * THE SOFTWARE.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
 #include <math.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../common/hcnote.h"
+#include "../common/hcstats.h"
 
 // On 2024-01-05 Peter Samson mentioned the CHM PDP-1 CPU runs 6% slower than spec
 #define CHM_PDP1_CPU_SPEED_MULTIPLIER 0.94
-#define NOTES_BUFFER_SIZE 8192
+#define READ_BUFFER_SIZE (1 << 20)
+
+// how a voice's decode ended
+#define VOICE_OK        0   // decoded, and more of the tape follows
+#define VOICE_LAST      1   // decoded up to the end of the tape
+#define VOICE_NOTES_EOF 2   // the tape ended in the notes part
+#define VOICE_FAILED    3   // invalid, see error
 
-// TODO: support minor keys too
-char *NOTE_NAMES[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
-char *REST_NAME = "r";
-char *ARTICULATION_NAMES[] = { "normal", "quarter", "half", "staccato", "legato" };
+typedef struct {
+    uint32_t number;
+    const uint8_t *tape;        // the whole tape, each voice starts reading at its own offset
+    size_t length;
+    size_t pos;
+    uint32_t word_count;        // words read on the tape so far, starting from the words of the voices before this one
+    uint32_t *notes;
+    uint32_t notes_count;
+    FILE *out;                  // the voice's decoded text, written out in voice order once every voice is done
+    char *text;
+    size_t text_length;
+    int result;
+    char error[256];            // for stderr, once the voices before have been written out
+    hc_counters_t counts;
+    jmp_buf fail;
+} voice_t;
 
 typedef struct {
-    uint8_t articulation;
-    uint8_t triplet;
-    uint8_t pitch;
-    uint8_t duration;
-    uint8_t note_duration;
-    uint8_t note_pitch;
-    uint8_t octave;
-    uint8_t semi_tone;
-    char *note_name;
-} note_t;
-
-uint32_t rpb(FILE *fp, uint32_t *gap_frames, uint32_t *inner_frames) {
+    voice_t *voices;
+    uint32_t voices_count;
+    atomic_uint next;
+} decode_queue_t;
+
+// stops decoding the voice, the message goes to stderr after everything the voice printed before it
+_Noreturn void fail(voice_t *v, const char *format, ...) {
+    va_list ap;
+
+    va_start(ap, format);
+    vsnprintf(v->error, sizeof(v->error), format, ap);
+    va_end(ap);
+    longjmp(v->fail, 1);
+}
+
+uint32_t rpb(voice_t *v, uint32_t *gap_frames, uint32_t *inner_frames) {
     uint32_t word = 0;
     int c;
 
@@ -61,7 +95,10 @@ uint32_t rpb(FILE *fp, uint32_t *gap_frames, uint32_t *inner_frames) {
     *inner_frames = 0;
 
     for (int i = 0; i < 3;) {
-        if ((c = fgetc(fp)) == EOF) return EOF;
+        if (v->pos == v->length) return EOF;
+        c = v->tape[v->pos++];
+        HC_COUNT(bytes_read, 1);
+        HC_COUNT(frames_read, 1);
 
         if (c & 0200) {
             // rbp skips lines without the 8th bit set, ignores 7th bit
@@ -72,88 +109,58 @@ uint32_t rpb(FILE *fp, uint32_t *gap_frames, uint32_t *inner_frames) {
                 (*inner_frames)++;
             } else {
                 (*gap_frames)++;
+                HC_COUNT(gap_frames, 1);
             }
         }
     }
 
+    HC_COUNT(words_read, 1);
     return word;
 }
 
-uint32_t read_next_word(FILE *fp, uint32_t *word, uint32_t *word_count, uint32_t *gap_frames, uint8_t peek) {
+uint32_t read_next_word(voice_t *v, uint32_t *word, uint32_t *gap_frames, uint8_t peek) {
     uint32_t inner_frames;
     uint32_t gap_frames_int;
-    *word = rpb(fp, &gap_frames_int, &inner_frames);
+    *word = rpb(v, &gap_frames_int, &inner_frames);
 
     if (inner_frames) {
-        fprintf(
-            stderr,
+        fail(
+            v,
             "ERROR: %d inner blank frame%s found in word %06o\n",
             inner_frames,
             inner_frames == 1 ? "" : "s",
-            *word_count
+            v->word_count
         );
-        exit(1);
     }
 
-    if (gap_frames_int) printf("[%d blank frame%s]\n", gap_frames_int, gap_frames_int == 1 ? "" : "s");
+    if (gap_frames_int) fprintf(v->out, "[%d blank frame%s]\n", gap_frames_int, gap_frames_int == 1 ? "" : "s");
     if (gap_frames)     *gap_frames = gap_frames_int;
     if (*word == EOF)   return EOF;
 
     if (!peek) {
-        printf("%06o: %06o", *word_count, *word);
+        fprintf(v->out, "%06o: %06o", v->word_count, *word);
     }
 
-    (*word_count)++;
+    v->word_count++;
 
     return 0;
 }
 
-uint32_t peek_gap(FILE *fp, uint32_t *gap_frames) {
+uint32_t peek_gap(voice_t *v, uint32_t *gap_frames) {
     uint32_t word;
     uint32_t inner_frames;
-    long current_pos;
+    size_t current_pos = v->pos;
 
-    // save the current file position
-    current_pos = ftell(fp);
-    if (current_pos == -1) {
-        perror("invalid file position while peeking gap");
-        return EOF;
-    }
+    // read the next word to get the gap frames, it's read again for real later so isn't counted now
+    hc_counters_t counts = *hc_counts;
+    word = rpb(v, gap_frames, &inner_frames);
+    *hc_counts = counts;
 
-    // read the next word to get the gap frames
-    word = rpb(fp, gap_frames, &inner_frames);
-
-    // restore the file position
-    if (fseek(fp, current_pos, SEEK_SET) != 0) {
-        perror("fseek");
-        return EOF;
-    }
+    v->pos = current_pos;
 
     return word == EOF ? EOF : 0;
 }
 
-void parse_note(uint32_t word, note_t *note) {
-    note->articulation = ((word >> 14) & 014) | ((word & 0060000) >> 13);
-    note->triplet = (word & 0100000) >> 15;
-    note->pitch = (word >> 7) & 077;
-    note->duration = word & 0177;
-
-    note->note_duration = 192 / (note->duration * (note->triplet ? 2 : 3));
-
-    if (note->pitch > 1) {
-        // note_pitch is the pitch above the 2 rest pitches, where 0 is C1
-        note->note_pitch = note->pitch - 2;
-        note->octave = note->note_pitch / 12 + 1;
-        note->semi_tone = note->note_pitch % 12;
-        note->note_name = NOTE_NAMES[note->semi_tone];
-    } else {
-        note->note_pitch = 0;
-        note->octave = 0;
-        note->semi_tone = 0;
-        note->note_name = REST_NAME;
-    }
-}
-
 uint32_t decode_tempo_quarter(uint32_t tempo) {
     // the documentation shows the tempo encoded as 1126/(m*f)
     // Ken Sumrall's hc_midimaker code shows the tempo encoded as 2861/(m*f)
@@ -164,52 +171,40 @@ uint32_t decode_tempo_quarter(uint32_t tempo) {
 
 uint32_t add_1s_complement(uint32_t a, uint32_t b) {
     uint32_t sum = a + b;
+    HC_COUNT(checksum_ops, 1);
     // add the carry to the sum and mask off potential overflow
     return ((sum & 0777777) + (sum >> 18)) & 0777777;
 }
 
-void verify_checksum(uint32_t expected, uint32_t calculated) {
+void verify_checksum(voice_t *v, uint32_t expected, uint32_t calculated) {
     if (expected == calculated) {
-        puts("\tgood checksum");
+        fputs("\tgood checksum\n", v->out);
     } else {
-        printf("\tchecksum mismatch: expected: %06o, calculated: %06o\n", expected, calculated);
-        exit(1);
+        fprintf(v->out, "\tchecksum mismatch: expected: %06o, calculated: %06o\n", expected, calculated);
+        fail(v, "");
     }
 }
 
-char* articulation_name(uint32_t articulation) {
-    int articulation_index;
-    switch (articulation) {
-        case 0:
-        case 1:
-        case 2:
-            articulation_index = articulation;
-            break;
-        case 4:
-            articulation_index = 3;
-            break;
-        case 8:
-            articulation_index = 4;
-            break;
-        default:
-            fprintf(stderr, "ERROR: invalid articulation: %d\n", articulation);
-            exit(1);
+const char *articulation_name(voice_t *v, uint32_t articulation) {
+    const char *name = hc_articulation_name(articulation);
+    if (!name) {
+        fail(v, "ERROR: invalid articulation: %d\n", articulation);
     }
-    return ARTICULATION_NAMES[articulation_index];
+    return name;
 }
 
-int read_notes(FILE *fp, uint32_t *word_count, uint32_t *notes, uint32_t *notes_count) {
+int read_notes(voice_t *v) {
     uint32_t word;
     uint32_t checksum = 0;
     uint32_t part_word_count = 0;
-    uint32_t total_word_count;
+    uint32_t total_word_count = 0;
     uint32_t tempo;
-    note_t note;
+    hc_note_t note;
 
-    puts("NOTES:");
+    fputs("NOTES:\n", v->out);
 
     while (1) {
-        if (read_next_word(fp, &word, word_count, NULL, 0) == EOF) {
+        if (read_next_word(v, &word, NULL, 0) == EOF) {
             // we should never hit EOF in the notes section, as the bar section should always follow
             return EOF;
         }
@@ -220,42 +215,49 @@ int read_notes(FILE *fp, uint32_t *word_count, uint32_t *notes, uint32_t *notes_
             // add the checksum for all note words, excluding the word count and checksum itself
             checksum = add_1s_complement(checksum, word);
             // word count is 2 higher, since we skip the word count, and increment the word count above
-            notes[part_word_count - 2] = word;
+            v->notes[part_word_count - 2] = word;
         }
 
         if (part_word_count == 1) {
             total_word_count = word;
-            *notes_count = total_word_count - 1;    // exclude the checksum word
-            printf("\tnotes word count: %d\n", total_word_count);
+            v->notes_count = total_word_count - 1;    // exclude the checksum word
+            v->notes = malloc((total_word_count ? total_word_count : 1) * sizeof(uint32_t));
+            if (!v->notes) {
+                fail(v, "could not allocate %lu bytes for notes buffer\n", total_word_count * sizeof(uint32_t));
+            }
+            fprintf(v->out, "\tnotes word count: %d\n", total_word_count);
         } else if (part_word_count == total_word_count + 2) {
-            verify_checksum(word, checksum);
+            verify_checksum(v, word, checksum);
             break;
         } else if (word == 0600000) {
-            puts("\t/");
+            fputs("\t/\n", v->out);
         } else if ((word & 0700000) == 0700000) {
             tempo = decode_tempo_quarter(word);
-            printf(
+            fprintf(
+                v->out,
                 "\ttempo: %d BPM [%d BPM for CHM PDP-1] (assuming 4/4 time) [raw: %d]\n",
                 tempo,
                 (int)(tempo * CHM_PDP1_CPU_SPEED_MULTIPLIER),
                 word & 0077777
             );
         } else {
-            parse_note(word, &note);
+            hc_parse_note(word, &note);
 
             if (note.pitch > 1) {
-                printf(
+                fprintf(
+                    v->out,
                     "\tarticulation: %02o [%s], triplet: %o [%s], ",
                     note.articulation,
-                    articulation_name(note.articulation),
+                    articulation_name(v, note.articulation),
                     note.triplet,
                     note.triplet ? "Y" : "N"
                 );
             } else {
-                printf("\t");
+                fputs("\t", v->out);
             }
 
-            printf(
+            fprintf(
+                v->out,
                 "pitch: %02o [%s%d], duration: %03o [1/%d]\n",
                 note.pitch,
                 note.note_name,
@@ -269,19 +271,18 @@ int read_notes(FILE *fp, uint32_t *word_count, uint32_t *notes, uint32_t *notes_
     return 0;
 }
 
-int read_bars(FILE *fp, uint32_t *word_count, uint32_t *notes, uint32_t notes_count) {
+int read_bars(voice_t *v) {
     uint32_t word;
     uint32_t checksum = 0;
     uint32_t gap_frames;
     uint32_t part_word_count = 0;
-    uint32_t total_word_count;
-    uint8_t tempo;
-    note_t note;
+    uint32_t total_word_count = 0;
+    hc_note_t note;
 
-    puts("\nBARS:");
+    fputs("\nBARS:\n", v->out);
 
     while (1) {
-        if (read_next_word(fp, &word, word_count, &gap_frames, 0) == EOF) {
+        if (read_next_word(v, &word, &gap_frames, 0) == EOF) {
             return EOF;
         }
 
@@ -294,19 +295,22 @@ int read_bars(FILE *fp, uint32_t *word_count, uint32_t *notes, uint32_t notes_co
 
         if (part_word_count == 1) {
             if (!gap_frames) {
-                perror("ERROR: bars part must have blank frames between preceeding notes part");
-                exit(1);
+                fail(v, "ERROR: bars part must have blank frames between preceeding notes part\n");
             }
 
             total_word_count = word;
-            printf("\tbars word count: %d\n", total_word_count);
+            fprintf(v->out, "\tbars word count: %d\n", total_word_count);
         } else if (part_word_count == total_word_count + 2) {
-            verify_checksum(word, checksum);
+            verify_checksum(v, word, checksum);
 
             // peek the next word to see if there are any more voices
-            if (peek_gap(fp, &gap_frames) == EOF) {
+            if (peek_gap(v, &gap_frames) == EOF) {
+                // the trailer is only ever peeked, so count it here
+                HC_COUNT(bytes_read, gap_frames);
+                HC_COUNT(frames_read, gap_frames);
+                HC_COUNT(gap_frames, gap_frames);
                 if (gap_frames) {
-                    printf("[%d blank frame%s]\n", gap_frames, gap_frames == 1 ? "" : "s");
+                    fprintf(v->out, "[%d blank frame%s]\n", gap_frames, gap_frames == 1 ? "" : "s");
                 }
                 return EOF;
             }
@@ -314,87 +318,277 @@ int read_bars(FILE *fp, uint32_t *word_count, uint32_t *notes, uint32_t notes_co
             // on to the next voice
             break;
         } else if (word == 0600000) {
-            printf("\t/\n");
+            fputs("\t/\n", v->out);
             if (part_word_count != total_word_count + 1) {
-                perror("ERROR: found end of bars word (600000) before end of bars word count");
-                exit(1);
+                fail(v, "ERROR: found end of bars word (600000) before end of bars word count\n");
             }
         } else {
-            if (word >= notes_count) {
-                fprintf(stderr, "ERROR: note index %d out of range\n", word);
-                exit(1);
+            if (word >= v->notes_count) {
+                fail(v, "ERROR: note index %d out of range\n", word);
             }
 
             // print measure number
-            printf("\t%d", part_word_count - 1);
+            fprintf(v->out, "\t%d", part_word_count - 1);
 
-            uint32_t *measure_note = &notes[word];
+            uint32_t *measure_note = &v->notes[word];
             uint32_t note_count = 0;
-            while (*measure_note != 0600000 && (word + note_count) < notes_count) {
-                parse_note(*measure_note, &note);
-                printf(" %st%d", note.note_name, note.note_duration);
+            while (*measure_note != 0600000 && (word + note_count) < v->notes_count) {
+                hc_parse_note(*measure_note, &note);
+                fprintf(v->out, " %st%d", note.note_name, note.note_duration);
 
                 measure_note++;
                 note_count++;
             }
 
-            printf("/\n");
+            fputs("/\n", v->out);
+        }
+    }
+
+    return 0;
+}
+
+void decode_voice(voice_t *v) {
+    hc_counts = &v->counts;
+
+    v->out = open_memstream(&v->text, &v->text_length);
+    if (!v->out) {
+        snprintf(v->error, sizeof(v->error), "could not open output buffer for voice %d\n", v->number);
+        v->result = VOICE_FAILED;
+        return;
+    }
+
+    if (setjmp(v->fail)) {
+        v->result = VOICE_FAILED;
+    } else {
+        if (v->number > 1) fputs("\n\n", v->out);
+        fprintf(v->out, "╔═════════════╗\n");
+        fprintf(v->out, "║   VOICE %d   ║\n", v->number);
+        fprintf(v->out, "╚═════════════╝\n");
+
+        if (read_notes(v) == EOF) {
+            v->result = VOICE_NOTES_EOF;
+        } else {
+            v->result = read_bars(v) == EOF ? VOICE_LAST : VOICE_OK;
+        }
+    }
+
+    fclose(v->out);
+    free(v->notes);
+    hc_counts = &hc_stats.counts;
+}
+
+void *decode_worker(void *arg) {
+    decode_queue_t *queue = arg;
+    uint32_t i;
+
+    while ((i = atomic_fetch_add(&queue->next, 1)) < queue->voices_count) {
+        decode_voice(&queue->voices[i]);
+    }
+
+    return NULL;
+}
+
+// skips blank frames and reads a word's 3 frames, -1 at the end of the tape or a blank frame inside the word
+int scan_word(const uint8_t *tape, size_t length, size_t *pos, uint32_t *word) {
+    size_t p = *pos;
+
+    while (p < length && !(tape[p] & 0200)) p++;
+    if (p + 3 > length || !(tape[p + 1] & tape[p + 2] & 0200)) return -1;
+
+    *word = ((tape[p] & 077) << 12) | ((tape[p + 1] & 077) << 6) | (tape[p + 2] & 077);
+    *pos = p + 3;
+    return 0;
+}
+
+// skips words, a part's data is usually one run of binary frames, so that's checked a block at a time first
+int scan_skip(const uint8_t *tape, size_t length, size_t *pos, uint32_t words) {
+    size_t frames = (size_t)words * 3;
+    uint32_t word;
+
+    if (*pos + frames <= length) {
+        uint8_t all = 0200;
+        for (size_t i = 0; i < frames; i++) all &= tape[*pos + i];
+        if (all) {
+            *pos += frames;
+            return 0;
         }
     }
 
+    while (words--) {
+        if (scan_word(tape, length, pos, &word) < 0) return -1;
+    }
     return 0;
 }
 
+// rpb() finds another word after the bars part as long as 3 binary frames are left
+int scan_more(const uint8_t *tape, size_t length, size_t pos) {
+    int binary = 0;
+
+    for (; pos < length && binary < 3; pos++) {
+        if (tape[pos] & 0200) binary++;
+    }
+    return binary == 3;
+}
+
+/*
+ * Finds where each voice starts by hopping from part to part by the word counts at their heads, without decoding
+ * anything, so the voices can be decoded at the same time. A voice the scan can't get through (bad framing, a short
+ * tape) is the last one returned, and decoding it finds the same error the scan stopped at.
+ */
+voice_t *scan_voices(const uint8_t *tape, size_t length, uint32_t max_voices, uint32_t *voices_count) {
+    voice_t *voices = NULL;
+    uint32_t capacity = 0;
+    uint32_t count = 0;
+    uint32_t words = 0;
+    size_t pos = 0;
+    uint32_t word;
+
+    while (count < max_voices) {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            voice_t *grown = realloc(voices, capacity * sizeof(voice_t));
+            if (!grown) {
+                free(voices);
+                return NULL;
+            }
+            voices = grown;
+        }
+
+        voice_t *v = &voices[count++];
+        memset(v, 0, sizeof(voice_t));
+        v->number = count;
+        v->tape = tape;
+        v->length = length;
+        v->pos = pos;
+        v->word_count = words;
+
+        // the notes part, then the bars part
+        int part;
+        for (part = 0; part < 2; part++) {
+            if (scan_word(tape, length, &pos, &word) < 0 || scan_skip(tape, length, &pos, word + 1) < 0) break;
+            words += word + 2;
+        }
+        if (part < 2 || !scan_more(tape, length, pos)) break;
+    }
+
+    *voices_count = count;
+    return voices;
+}
+
+uint8_t *read_tape(FILE *fp, size_t *length) {
+    uint8_t *tape = NULL;
+    size_t capacity = 0;
+    size_t n;
+
+    *length = 0;
+    do {
+        if (*length == capacity) {
+            capacity = capacity ? capacity * 2 : READ_BUFFER_SIZE;
+            uint8_t *grown = realloc(tape, capacity);
+            if (!grown) {
+                free(tape);
+                return NULL;
+            }
+            tape = grown;
+        }
+        n = fread(tape + *length, 1, capacity - *length, fp);
+        *length += n;
+    } while (n);
+
+    return tape;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <file> (use '-' for stdin)\n", argv[0]);
+    hc_stats_init("decodehcint", &argc, argv);
+
+    uint32_t max_voices = 4;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "aj:")) != -1) {
+        switch (opt) {
+            case 'a': max_voices = UINT32_MAX; break;
+            case 'j': jobs = atol(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-a] [-j threads] <file> (use '-' for stdin) [--stats[=<file>]]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-a] [-j threads] <file> (use '-' for stdin) [--stats[=<file>]]\n", argv[0]);
         return 1;
     }
 
     FILE *fp;
-    if (strcmp(argv[1], "-") == 0) {
+    if (strcmp(argv[optind], "-") == 0) {
         fp = stdin;
     } else {
-        fp = fopen(argv[1], "rb");
+        fp = fopen(argv[optind], "rb");
         if (!fp) {
-            fprintf(stderr, "could not open file %s\n", argv[1]);
+            fprintf(stderr, "could not open file %s\n", argv[optind]);
             return 1;
         }
     }
 
-    uint32_t word_count = 0;
-    uint32_t notes_count = 0;
-    uint8_t voice = 1;
+    hc_stats_phase("read");
+    size_t length;
+    uint8_t *tape = read_tape(fp, &length);
+    if (!tape) {
+        fprintf(stderr, "could not allocate memory for the tape\n");
+        return 1;
+    }
+    if (strcmp(argv[optind], "-")) {
+        fclose(fp);
+    }
 
-    uint32_t *notes = malloc(NOTES_BUFFER_SIZE * sizeof(uint32_t));
-    if (!notes) {
-        fprintf(stderr, "could not allocate %lu bytes for notes buffer\n", NOTES_BUFFER_SIZE * sizeof(uint32_t));
+    hc_stats_phase("scan");
+    decode_queue_t queue = { 0 };
+    queue.voices = scan_voices(tape, length, max_voices, &queue.voices_count);
+    if (!queue.voices) {
+        fprintf(stderr, "could not allocate memory for the voices\n");
         return 1;
     }
 
-    while (voice <= 4) {
-        if (voice > 1) puts("\n");
-        printf("╔═════════════╗\n");
-        printf("║   VOICE %d   ║\n", voice);
-        printf("╚═════════════╝\n");
+    hc_stats_phase("decode");
+    if (jobs < 1) jobs = 1;
+    if (jobs > queue.voices_count) jobs = queue.voices_count;
 
-        if (read_notes(fp, &word_count, notes, &notes_count) == EOF) {
+    pthread_t threads[jobs];
+    long started = 0;
+    while (started < jobs - 1 && !pthread_create(&threads[started], NULL, decode_worker, &queue)) started++;
+    decode_worker(&queue);
+    for (long i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+    for (uint32_t i = 0; i < queue.voices_count; i++) hc_stats_add(&queue.voices[i].counts);
+
+    hc_stats_phase("write");
+    uint32_t word_count = 0;
+    for (uint32_t i = 0; i < queue.voices_count; i++) {
+        voice_t *v = &queue.voices[i];
+
+        fwrite(v->text, 1, v->text_length, stdout);
+        free(v->text);
+        word_count = v->word_count;
+
+        if (v->result == VOICE_NOTES_EOF) {
+            fflush(stdout);
             perror("EOF in notes section\n");
             return 1;
-        }
-
-        if (read_bars(fp, &word_count, notes, notes_count) == EOF) {
+        } else if (v->result == VOICE_FAILED) {
+            fflush(stdout);
+            fputs(v->error, stderr);
+            return 1;
+        } else if (v->result == VOICE_LAST) {
             break;
         }
-        voice++;
     }
 
     printf("\nDATA LENGTH: %dB\n", (int)ceil((float)word_count * 18.0f / 8.0f));
 
-    free(notes);
-    if (strcmp(argv[1], "-")) {
-        fclose(fp);
-    }
-    
+    free(queue.voices);
+    free(tape);
+
+    hc_stats.complete = 1;
     return 0;
 }
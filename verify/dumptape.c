@@ -0,0 +1,299 @@
+/*
+ * dumptape.c
+ *
+ * This program dumps any paper tape image frame by frame, showing the punched holes, the 18-bit binary words read
+ * the way the PDP-1 rpb instruction reads them, runs of blank frames, and optionally the decoded Harmony Compiler
+ * intermediate tape structure (-m) alongside.
+ * Usage: ./dumptape [-w] [-m] [-a] [-s first byte] [-e last byte] [-n byte count] <file> (use '-' for stdin)
+ *   -w  words only, one line per binary word instead of one line per frame
+ *   -m  annotate words with the decoded music (part word counts, notes, tempo, bars, checksums)
+ *   -a  print every blank frame instead of collapsing runs of them
+ *   -s  zero-based offset of the first byte to dump (decimal, 0octal or 0xhex)
+ *   -e  zero-based offset of the last byte to dump (inclusive)
+ *   -n  number of bytes to dump
+ * 
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../common/hctape.h"
+
+#define READ_BUFFER_SIZE (1 << 16)
+#define ANNOTATION_SIZE 1024
+
+typedef struct {
+    int words_only;
+    int music;
+    int all_blanks;
+
+    // framing and music decoding state, fed every byte from the start of the tape so words are right after seeking
+    hc_framer_t framer;
+    hc_parts_t parts;
+    uint32_t word_count;
+    uint32_t *notes;
+    uint32_t notes_count;
+    uint32_t notes_capacity;
+
+    // output state
+    int printing;
+    uint64_t run_start;
+    uint32_t run_frames;
+    uint64_t word_start;
+} dump_t;
+
+// hole glyphs for every frame value, laid out like title/dump.py: bits 7..3, the feed hole, then bits 2..0
+static char frame_glyphs[256][32];
+
+void build_frame_glyphs(void) {
+    for (int c = 0; c < 256; c++) {
+        char *p = frame_glyphs[c];
+        for (int bit = 7; bit >= 0; bit--) {
+            if (bit == 2) {
+                strcpy(p, "·");
+                p += strlen("·");
+            }
+            if (c & (1 << bit)) {
+                strcpy(p, "○");
+                p += strlen("○");
+            } else {
+                *p++ = ' ';
+            }
+        }
+        *p = '\0';
+    }
+}
+
+void flush_run(dump_t *d) {
+    if (d->run_frames && d->printing) {
+        printf("%10llu  [%u blank frame%s]\n", (unsigned long long)d->run_start, d->run_frames, d->run_frames == 1 ? "" : "s");
+    }
+    d->run_frames = 0;
+}
+
+void store_note(dump_t *d, uint32_t word) {
+    if (d->notes_count == d->notes_capacity) {
+        d->notes_capacity = d->notes_capacity ? d->notes_capacity * 2 : 1024;
+        d->notes = realloc(d->notes, d->notes_capacity * sizeof(uint32_t));
+        if (!d->notes) {
+            fprintf(stderr, "could not allocate %u notes\n", d->notes_capacity);
+            exit(1);
+        }
+    }
+    d->notes[d->notes_count++] = word;
+}
+
+// describe a completed word in *annotation, updating the music decoding state
+void annotate_word(dump_t *d, uint32_t word, char *annotation) {
+    hc_note_t note;
+    hc_word_kind_t kind = hc_parts_push(&d->parts, word);
+    const char *part_name = d->parts.kind == HC_PART_NOTES ? "notes" : "bars";
+    int n = 0;
+
+    annotation[0] = '\0';
+
+    if (!d->printing) {
+        // still seeking, only the decoder state matters
+        if (kind == HC_WORD_COUNT && d->parts.kind == HC_PART_NOTES) d->notes_count = 0;
+        if (kind == HC_WORD_DATA && d->parts.kind == HC_PART_NOTES) store_note(d, word);
+        return;
+    }
+
+    if (d->framer.inner_frames) {
+        n += snprintf(annotation + n, ANNOTATION_SIZE - n, "[%u inner blank frame%s] ",
+            d->framer.inner_frames, d->framer.inner_frames == 1 ? "" : "s");
+    }
+
+    switch (kind) {
+        case HC_WORD_COUNT:
+            if (d->parts.kind == HC_PART_NOTES) d->notes_count = 0;
+            snprintf(annotation + n, ANNOTATION_SIZE - n, "voice %u %s word count: %u", d->parts.voice, part_name, word);
+            break;
+        case HC_WORD_CHECKSUM_GOOD:
+            snprintf(annotation + n, ANNOTATION_SIZE - n, "%s checksum good", part_name);
+            break;
+        case HC_WORD_CHECKSUM_BAD:
+            snprintf(annotation + n, ANNOTATION_SIZE - n, "%s checksum mismatch: calculated %06o", part_name, d->parts.checksum);
+            break;
+        case HC_WORD_DATA:
+            if (d->parts.kind == HC_PART_NOTES) {
+                store_note(d, word);
+                if (word == HC_END_OF_MEASURE) {
+                    snprintf(annotation + n, ANNOTATION_SIZE - n, "/");
+                } else if ((word & HC_TEMPO_MASK) == HC_TEMPO_MASK) {
+                    uint32_t tempo = hc_decode_tempo_quarter(word);
+                    snprintf(annotation + n, ANNOTATION_SIZE - n, "tempo: %u BPM [%u BPM for CHM PDP-1] [raw: %u]",
+                        tempo, (uint32_t)(tempo * CHM_PDP1_CPU_SPEED_MULTIPLIER), word & 0077777);
+                } else {
+                    hc_parse_note(word, &note);
+                    const char *articulation = hc_articulation_name(note.articulation);
+                    if (note.pitch > 1) {
+                        snprintf(annotation + n, ANNOTATION_SIZE - n, "%s%d t%d %s%s", note.note_name, note.octave,
+                            note.note_duration, articulation ? articulation : "?", note.triplet ? " triplet" : "");
+                    } else {
+                        snprintf(annotation + n, ANNOTATION_SIZE - n, "r t%d", note.note_duration);
+                    }
+                }
+            } else if (word == HC_END_OF_MEASURE) {
+                snprintf(annotation + n, ANNOTATION_SIZE - n, "/");
+            } else if (word >= d->notes_count) {
+                snprintf(annotation + n, ANNOTATION_SIZE - n, "bar %u: note index out of range", d->parts.pos);
+            } else {
+                n += snprintf(annotation + n, ANNOTATION_SIZE - n, "bar %u:", d->parts.pos);
+                for (uint32_t i = word; i < d->notes_count && d->notes[i] != HC_END_OF_MEASURE; i++) {
+                    if (n >= ANNOTATION_SIZE - 16) {
+                        n += snprintf(annotation + n, ANNOTATION_SIZE - n, " ...");
+                        break;
+                    }
+                    hc_parse_note(d->notes[i], &note);
+                    n += snprintf(annotation + n, ANNOTATION_SIZE - n, " %st%d", note.note_name, note.note_duration);
+                }
+                if (n < ANNOTATION_SIZE) snprintf(annotation + n, ANNOTATION_SIZE - n, "/");
+            }
+            break;
+    }
+}
+
+void dump_byte(dump_t *d, uint64_t offset, int c) {
+    char annotation[ANNOTATION_SIZE];
+    uint32_t word;
+
+    if (d->framer.frames == 0 && (c & 0200)) d->word_start = offset;
+    int complete = hc_framer_push(&d->framer, c, &word);
+
+    if (complete && d->music) {
+        annotate_word(d, word, annotation);
+    }
+
+    if (d->printing) {
+        int blank = d->words_only ? !(c & 0200) : (c == 0 && !d->all_blanks);
+        if (blank) {
+            if (!d->run_frames) d->run_start = offset;
+            d->run_frames++;
+        } else {
+            flush_run(d);
+            if (!d->words_only) {
+                printf("%10llu  %03o  %s", (unsigned long long)offset, c, frame_glyphs[c]);
+                if (complete) printf("  %06o: %06o", d->word_count, word);
+                if (complete && d->music) printf("  %s", annotation);
+                putchar('\n');
+            } else if (complete) {
+                printf("%10llu  %06o: %06o", (unsigned long long)d->word_start, d->word_count, word);
+                if (d->music) printf("  %s", annotation);
+                putchar('\n');
+            }
+        }
+    }
+
+    if (complete) {
+        d->word_count++;
+        hc_framer_next(&d->framer);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    dump_t d;
+    uint64_t start = 0;
+    uint64_t end = UINT64_MAX;
+    uint64_t count = UINT64_MAX;
+    int opt;
+
+    memset(&d, 0, sizeof(d));
+    hc_parts_init(&d.parts);
+
+    while ((opt = getopt(argc, argv, "wmas:e:n:")) != -1) {
+        switch (opt) {
+            case 'w': d.words_only = 1; break;
+            case 'm': d.music = 1; break;
+            case 'a': d.all_blanks = 1; break;
+            case 's': start = strtoull(optarg, NULL, 0); break;
+            case 'e': end = strtoull(optarg, NULL, 0); break;
+            case 'n': count = strtoull(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "Usage: %s [-w] [-m] [-a] [-s first byte] [-e last byte] [-n byte count] <file> (use '-' for stdin)\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-w] [-m] [-a] [-s first byte] [-e last byte] [-n byte count] <file> (use '-' for stdin)\n", argv[0]);
+        return 1;
+    }
+
+    if (count != UINT64_MAX && (end == UINT64_MAX || start + count - 1 < end)) {
+        end = count ? start + count - 1 : 0;
+        if (!count) return 0;
+    }
+
+    FILE *fp;
+    if (strcmp(argv[optind], "-") == 0) {
+        fp = stdin;
+    } else {
+        fp = fopen(argv[optind], "rb");
+        if (!fp) {
+            fprintf(stderr, "could not open file %s\n", argv[optind]);
+            return 1;
+        }
+    }
+
+    build_frame_glyphs();
+    setvbuf(stdout, NULL, _IOFBF, READ_BUFFER_SIZE * 16);
+
+    // every byte goes through the framer from the start of the tape, so words after -s are framed and numbered
+    // the way the PDP-1 reads them rather than from wherever the offset lands
+    uint64_t offset = 0;
+
+    unsigned char *buffer = malloc(READ_BUFFER_SIZE);
+    if (!buffer) {
+        fprintf(stderr, "could not allocate %d bytes for read buffer\n", READ_BUFFER_SIZE);
+        return 1;
+    }
+
+    size_t n;
+    while (offset <= end && (n = fread(buffer, 1, READ_BUFFER_SIZE, fp)) > 0) {
+        for (size_t i = 0; i < n && offset <= end; i++, offset++) {
+            if (offset < start) {
+                // skipping up to the first byte, only the framer and decoder need to see these
+                dump_byte(&d, offset, buffer[i]);
+                continue;
+            }
+            d.printing = 1;
+            dump_byte(&d, offset, buffer[i]);
+        }
+    }
+
+    flush_run(&d);
+
+    free(buffer);
+    free(d.notes);
+    if (strcmp(argv[optind], "-")) {
+        fclose(fp);
+    }
+
+    return 0;
+}
@@ -0,0 +1,460 @@
+/*
+ * pitchcheck.c
+ *
+ * This program checks that a Harmony Compiler intermediate binary paper tape image plays the pitches it was arranged
+ * with, so a transposition slip doesn't have to be caught by ear. The tape is decoded for the expected pitch of every
+ * note and either rendered the way render does (each voice on its own), or compared against a WAV from any renderer
+ * that follows render's timeline and channels (voices 1 and 2 left, 3 and 4 right, or all of them in a mono file).
+ * A bank of Goertzel filters a few cents apart around the expected pitch finds each note's dominant frequency, and
+ * notes further off than the threshold are listed. Notes are checked against the intended key at the PDP-1's specified
+ * speed, so -c alone lists every note at the CHM machine's detune (about -107 cents), and -c -T 1 checks that the
+ * one semitone transposition makes up for it.
+ * Usage: ./pitchcheck [-c] [-T semitones] [-d cents] [-R cents] [-r rate] [-w file.wav] [-q] <file>
+ *        (use '-' for stdin)
+ *   -c  the tape plays at the CHM PDP-1's speed, lowering every pitch by about a semitone
+ *   -T  semitones the arrangement is transposed up from the intended key (e.g. -c -T 1 for the CHM transposition);
+ *       by default the pitch fields are the intended key
+ *   -d  cents a note may be off before it's listed (default: 25)
+ *   -R  cents either side of the expected pitch to search (default: 150)
+ *   -r  sample rate to render at (default: 44100)
+ *   -w  check this 16-bit PCM or float WAV instead of rendering
+ *   -q  only the summary line
+ * Exits 0 when every note is within the threshold, 2 when some aren't, 1 when the tape or WAV couldn't be read.
+ *
+ * In a WAV the two voices sharing a channel can't be told apart when they play within the search range of each
+ * other, so those notes are counted as masked instead of checked. Notes too short for a few periods of their pitch
+ * are skipped either way.
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/hctape.h"
+#include "../common/hcrender.h"
+
+#define DEFAULT_THRESHOLD 25.0
+#define DEFAULT_RANGE 150.0
+#define BANK_STEP 5.0               // cents between filters
+#define MAX_BINS 128                // a multiple of the vector width, the bank pads up to it
+#define TRIM 0.15                   // of a note's sounding time dropped at each end, away from the attack and release
+#define MAX_WINDOW 0.5              // seconds analyzed from the middle of a long note
+#define MIN_WINDOW 0.01
+#define MIN_PERIODS 4
+
+typedef struct {
+    size_t start;           // sounding samples, as hc_render_voice places them
+    size_t end;
+    double seconds;
+    double played;         // frequency the tape plays at the given speed
+    double expected;       // frequency it's checked against, in the intended key at the specified speed
+    long event;
+    uint8_t pitch;
+} note_t;
+
+typedef struct {
+    note_t *notes;
+    long count;
+    const float *samples;
+    size_t frames;
+} voice_t;
+
+typedef struct {
+    long checked;
+    long off;
+    long masked;
+    long short_notes;
+    double worst;
+} totals_t;
+
+static void help(void) {
+    fprintf(stderr,
+        "Usage: ./pitchcheck [-c] [-T semitones] [-d cents] [-R cents] [-r rate] [-w file.wav] [-q] <file>\n"
+        "       (use '-' for stdin)\n"
+        "  -c  the tape plays at the CHM PDP-1's speed, %d%% of spec\n"
+        "  -T  semitones the arrangement is transposed up from the intended key (e.g. -c -T 1); -c alone\n"
+        "      reports the CHM machine's detune\n"
+        "  -d  cents a note may be off before it's listed (default: %g)\n"
+        "  -R  cents either side of the expected pitch to search (default: %g)\n"
+        "  -r  sample rate to render at (default: %d)\n"
+        "  -w  check this WAV instead of rendering\n"
+        "  -q  only the summary line\n",
+        (int)(CHM_PDP1_CPU_SPEED_MULTIPLIER * 100), DEFAULT_THRESHOLD, DEFAULT_RANGE, HC_DEFAULT_SAMPLE_RATE);
+}
+
+static double cents(double frequency, double reference) {
+    return 1200.0 * log2(frequency / reference);
+}
+
+// the notes of a voice on hc_render_voice's timeline, rests left out
+static long voice_notes(const hc_event_t *events, long count, const hc_render_options_t *opts, double transpose, note_t **notes) {
+    double time = 0;
+    long n = 0;
+
+    *notes = malloc((count ? count : 1) * sizeof(note_t));
+    if (!*notes) return -1;
+
+    for (long i = 0; i < count; i++) {
+        const hc_event_t *e = &events[i];
+        double length = e->ticks * hc_tick_seconds(opts->tempo ? opts->tempo : e->tempo) / opts->speed;
+        note_t *note = &(*notes)[n];
+        note->start = (size_t)(time * opts->sample_rate + 0.5);
+        note->end = (size_t)((time + length * hc_sounding_fraction(e->articulation)) * opts->sample_rate + 0.5);
+        note->seconds = time;
+        time += length;
+
+        if (e->pitch < 2) continue;
+        note->played = hc_pitch_frequency(e->pitch) * opts->speed;
+        note->expected = hc_pitch_frequency(e->pitch) * pow(2.0, -transpose / 12.0);
+        note->event = i;
+        note->pitch = e->pitch;
+        n++;
+    }
+
+    return n;
+}
+
+/*
+ * Runs a bank of Goertzel filters spaced BANK_STEP cents apart, centered on the given frequency, over the Hann
+ * windowed samples, and returns the dominant frequency's offset from the center in cents. The filters all see the same
+ * sample at once, so the loop over the bank is what vectorizes. The peak is interpolated between filters on a
+ * parabola through the log powers.
+ */
+static double dominant_cents(const float *x, size_t n, double center, double rate, int half) {
+    int bins = 2 * half + 1;
+    int padded = (bins + 7) & ~7;
+    double coeff[MAX_BINS], s1[MAX_BINS], s2[MAX_BINS], power[MAX_BINS];
+
+    for (int b = 0; b < padded; b++) {
+        double f = center * pow(2.0, (b - half) * BANK_STEP / 1200.0);
+        coeff[b] = 2.0 * cos(2.0 * M_PI * f / rate);
+        s1[b] = s2[b] = 0;
+    }
+
+    // the Hann window's cosine steps by rotation rather than a cos() per sample
+    double w_step = 2.0 * cos(2.0 * M_PI / (n - 1));
+    double w_prev = cos(-2.0 * M_PI / (n - 1));
+    double w_cos = 1.0;
+    for (size_t i = 0; i < n; i++) {
+        double input = x[i] * (0.5 - 0.5 * w_cos);
+        double w_next = w_step * w_cos - w_prev;
+        w_prev = w_cos;
+        w_cos = w_next;
+
+        for (int b = 0; b < padded; b++) {
+            double s0 = input + coeff[b] * s1[b] - s2[b];
+            s2[b] = s1[b];
+            s1[b] = s0;
+        }
+    }
+
+    int peak = 0;
+    for (int b = 0; b < bins; b++) {
+        power[b] = s1[b] * s1[b] + s2[b] * s2[b] - coeff[b] * s1[b] * s2[b];
+        if (power[b] > power[peak]) peak = b;
+    }
+
+    double offset = 0;
+    if (peak > 0 && peak < bins - 1 && power[peak] > 0) {
+        double a = log(power[peak - 1] + 1e-300);
+        double b = log(power[peak]);
+        double c = log(power[peak + 1] + 1e-300);
+        if (a - 2 * b + c < 0) offset = 0.5 * (a - c) / (a - 2 * b + c);
+    }
+
+    return (peak - half + offset) * BANK_STEP;
+}
+
+// whether another voice on the channel sounds within range of the note during [start, end)
+static int masked(const voice_t *voices, uint32_t count, uint32_t self, const note_t *note, size_t start, size_t end,
+                  double range) {
+    for (uint32_t v = 0; v < count; v++) {
+        if (v == self || voices[v].samples != voices[self].samples) continue;
+
+        // notes are in time order, find the first that could still be sounding at start
+        const note_t *other = voices[v].notes;
+        long lo = 0, hi = voices[v].count;
+        while (lo < hi) {
+            long mid = (lo + hi) / 2;
+            if (other[mid].end <= start) lo = mid + 1; else hi = mid;
+        }
+        for (long i = lo; i < voices[v].count && other[i].start < end; i++) {
+            if (other[i].end > start && fabs(cents(other[i].played, note->played)) < range + 2 * BANK_STEP) return 1;
+        }
+    }
+    return 0;
+}
+
+static void check_voice(const voice_t *voices, uint32_t count, uint32_t v, double rate, double threshold,
+                        double range, int quiet, totals_t *totals) {
+    const voice_t *voice = &voices[v];
+    int half = (int)(range / BANK_STEP + 0.5);
+
+    for (long i = 0; i < voice->count; i++) {
+        const note_t *note = &voice->notes[i];
+        size_t start = note->start;
+        size_t end = note->end < voice->frames ? note->end : voice->frames;
+        size_t trim = (size_t)((end > start ? end - start : 0) * TRIM);
+        start += trim;
+        end = end > trim ? end - trim : 0;
+
+        size_t max_window = (size_t)(MAX_WINDOW * rate);
+        if (end > start && end - start > max_window) {
+            start += (end - start - max_window) / 2;
+            end = start + max_window;
+        }
+
+        if (end <= start || end - start < MIN_WINDOW * rate || end - start < MIN_PERIODS * rate / note->played) {
+            totals->short_notes++;
+            continue;
+        }
+        if (masked(voices, count, v, note, start, end, range)) {
+            totals->masked++;
+            continue;
+        }
+
+        double found = dominant_cents(voice->samples + start, end - start, note->played, rate, half);
+        double frequency = note->played * pow(2.0, found / 1200.0);
+        double off = cents(frequency, note->expected);
+        totals->checked++;
+        if (fabs(off) > fabs(totals->worst)) totals->worst = off;
+        if (fabs(off) <= threshold) continue;
+
+        totals->off++;
+        if (!quiet) {
+            const hc_pitch_t *p = &HC_PITCHES[note->pitch];
+            printf("voice %u event %ld at %.3fs: %s%u (pitch %u) expected %.2f Hz, dominant %.2f Hz, %+.0f cents%s\n",
+                v + 1, note->event + 1, note->seconds, HC_NOTE_NAMES[p->name], p->octave, note->pitch,
+                note->expected, frequency, off, fabs(found) >= range ? " (at the edge of the search)" : "");
+        }
+    }
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// loads a 16-bit PCM or 32-bit float WAV into one float buffer per channel (at most two used)
+static int load_wav(const char *path, float **channels, uint32_t *channel_count, size_t *frames, uint32_t *rate) {
+    FILE *fp = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+
+    size_t length;
+    uint8_t *data = hc_read_all(fp, &length);
+    if (fp != stdin) fclose(fp);
+    if (!data) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+
+    const uint8_t *fmt = NULL;
+    const uint8_t *samples = NULL;
+    size_t samples_bytes = 0;
+    if (length < 12 || memcmp(data, "RIFF", 4) || memcmp(data + 8, "WAVE", 4)) {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        free(data);
+        return -1;
+    }
+    for (size_t at = 12; at + 8 <= length;) {
+        uint32_t size = get_u32(data + at + 4);
+        size_t available = length - at - 8 < size ? length - at - 8 : size;
+        if (!memcmp(data + at, "fmt ", 4) && available >= 16) fmt = data + at + 8;
+        if (!memcmp(data + at, "data", 4)) {
+            samples = data + at + 8;
+            samples_bytes = available;
+        }
+        at += 8 + (size_t)size + (size & 1);
+    }
+
+    uint16_t format = fmt ? fmt[0] | fmt[1] << 8 : 0;
+    uint16_t count = fmt ? fmt[2] | fmt[3] << 8 : 0;
+    uint16_t bits = fmt ? fmt[14] | fmt[15] << 8 : 0;
+    if (format == 0xfffe && fmt && get_u32(fmt - 4) >= 26) format = fmt[24] | fmt[25] << 8;    // extensible
+    int pcm16 = format == 1 && bits == 16;
+    int float32 = format == 3 && bits == 32;
+    if (!samples || !count || (!pcm16 && !float32)) {
+        fprintf(stderr, "%s: only 16-bit PCM and 32-bit float WAVs are supported\n", path);
+        free(data);
+        return -1;
+    }
+
+    *rate = get_u32(fmt + 4);
+    *channel_count = count > 1 ? 2 : 1;
+    *frames = samples_bytes / (count * (bits / 8));
+    for (uint32_t c = 0; c < *channel_count; c++) {
+        channels[c] = malloc((*frames ? *frames : 1) * sizeof(float));
+        if (!channels[c]) {
+            fprintf(stderr, "out of memory\n");
+            free(data);
+            return -1;
+        }
+        for (size_t i = 0; i < *frames; i++) {
+            const uint8_t *s = samples + (i * count + c) * (bits / 8);
+            if (pcm16) {
+                channels[c][i] = (int16_t)(s[0] | s[1] << 8) / 32768.0f;
+            } else {
+                uint32_t u = get_u32(s);
+                memcpy(&channels[c][i], &u, sizeof(float));
+            }
+        }
+    }
+
+    free(data);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    hc_render_options_t opts = { NULL, HC_DEFAULT_SAMPLE_RATE, 1.0, 0 };
+    double transpose = 0;
+    double threshold = DEFAULT_THRESHOLD;
+    double range = DEFAULT_RANGE;
+    const char *wav_path = NULL;
+    int quiet = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "cT:d:R:r:w:qh")) != -1) {
+        switch (opt) {
+            case 'c': opts.speed = CHM_PDP1_CPU_SPEED_MULTIPLIER; break;
+            case 'T': transpose = atof(optarg); break;
+            case 'd': threshold = atof(optarg); break;
+            case 'R': range = atof(optarg); break;
+            case 'r': opts.sample_rate = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'w': wav_path = optarg; break;
+            case 'q': quiet = 1; break;
+            default: help(); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind != argc - 1 || !opts.sample_rate || threshold < 0 || range < BANK_STEP ||
+        2 * (int)(range / BANK_STEP + 0.5) + 1 > MAX_BINS) {
+        help();
+        return 1;
+    }
+    if (wav_path && !strcmp(wav_path, "-") && !strcmp(argv[optind], "-")) {
+        fprintf(stderr, "the tape and the WAV can't both come from stdin\n");
+        return 1;
+    }
+
+    FILE *fp = strcmp(argv[optind], "-") ? fopen(argv[optind], "rb") : stdin;
+    if (!fp) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    size_t length;
+    uint8_t *data = hc_read_all(fp, &length);
+    if (fp != stdin) fclose(fp);
+    if (!data) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    hc_decoder_t decoder;
+    hc_decoder_init(&decoder);
+    hc_decoder_feed(&decoder, data, length);
+    free(data);
+    if (hc_decoder_finish(&decoder) < 0) {
+        fprintf(stderr, "%s: %s\n", argv[optind], decoder.message);
+        hc_decoder_free(&decoder);
+        return 1;
+    }
+    if (!decoder.voices_count) {
+        fprintf(stderr, "%s: no voices on tape\n", argv[optind]);
+        hc_decoder_free(&decoder);
+        return 1;
+    }
+
+    float *channels[2] = { NULL, NULL };
+    uint32_t channel_count = 0;
+    size_t wav_frames = 0;
+    if (wav_path && load_wav(wav_path, channels, &channel_count, &wav_frames, &opts.sample_rate)) return 1;
+
+    uint32_t count = decoder.voices_count;
+    voice_t *voices = calloc(count, sizeof(voice_t));
+    if (!voices) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    struct timespec began, ended;
+    clock_gettime(CLOCK_MONOTONIC, &began);
+
+    double seconds = 0;
+    for (uint32_t v = 0; v < count; v++) {
+        hc_event_t *events;
+        long events_count = hc_voice_events(&decoder.voices[v], hc_song_tempo(&decoder.voices[0]), &events);
+        if (events_count < 0 || (voices[v].count = voice_notes(events, events_count, &opts, transpose,
+                                                               &voices[v].notes)) < 0) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+
+        if (wav_path) {
+            voices[v].samples = channels[channel_count == 2 && (v % 4) >= 2];
+            voices[v].frames = wav_frames;
+        } else {
+            // each voice alone, nothing to mask
+            double voice = hc_voice_seconds(events, events_count, &opts);
+            float *samples = calloc((size_t)(voice * opts.sample_rate + 0.5) + 1, sizeof(float));
+            if (!samples) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+            voices[v].frames = (size_t)(voice * opts.sample_rate + 0.5);
+            hc_render_voice(events, events_count, &opts, samples, voices[v].frames);
+            voices[v].samples = samples;
+        }
+        if (voices[v].frames / (double)opts.sample_rate > seconds) seconds = voices[v].frames / (double)opts.sample_rate;
+        free(events);
+    }
+
+    totals_t totals = { 0, 0, 0, 0, 0 };
+    for (uint32_t v = 0; v < count; v++) {
+        check_voice(voices, count, v, opts.sample_rate, threshold, range, quiet, &totals);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ended);
+    double elapsed = (ended.tv_sec - began.tv_sec) + (ended.tv_nsec - began.tv_nsec) / 1e9;
+
+    printf("%s: %ld notes checked in %u voices, %ld off by more than %g cents (worst %+.1f), %ld masked, %ld too short; "
+        "%.1f s of audio in %.2f s\n", wav_path ? wav_path : argv[optind], totals.checked, count, totals.off,
+        threshold, totals.worst, totals.masked, totals.short_notes, seconds, elapsed);
+
+    for (uint32_t v = 0; v < count; v++) {
+        free(voices[v].notes);
+        if (!wav_path) free((float *)voices[v].samples);
+    }
+    free(voices);
+    free(channels[0]);
+    free(channels[1]);
+    hc_decoder_free(&decoder);
+    return totals.off ? 2 : 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * salvage.c
+ *
+ * This program recovers what it can from damaged Harmony Compiler intermediate tape images (read-back or archival
+ * images with dropped, spurious or half-punched frames), where decodehcint stops at the first bad frame. Every part
+ * whose word count and checksum still agree is kept, notes and bars parts are paired back into voices, and the
+ * damaged spans between them are listed. The voices can be punched to a clean tape that decodehcint reads.
+ * Recovered voices are numbered in the order they are found, so when a voice is lost the ones after it are numbered
+ * lower than their place on the original tape.
+ * Usage: ./salvage [-q] [-g frames] [-o out.bin | -d dir] <file>... (use '-' for stdin)
+ *   -q  one summary line per image instead of every part and damaged span
+ *   -g  blank frames needed before a part start (default: 3)
+ *   -o  punch the recovered voices to this tape (one image only)
+ *   -d  punch each image's recovered voices to <dir>/<image file name>
+ * Exits 0 when every image was intact, 2 when something was damaged or a part couldn't be paired into a voice, 1 when
+ * an image couldn't be read or written.
+ *
+ * MIT License:
+ * Copyright 2025 Joe Lynch <joeblynch@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../common/hcsalvage.h"
+
+#define READ_BLOCK 65536
+
+static const char *PART_KINDS[] = { "unpaired part", "notes", "bars" };
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-q] [-g frames] [-o out.bin | -d dir] <file>... (use '-' for stdin)\n", name);
+}
+
+static uint8_t *read_file(const char *path, size_t *length) {
+    FILE *fp = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    uint8_t *data = NULL;
+    size_t capacity = 0;
+    size_t n;
+
+    *length = 0;
+    if (!fp) {
+        perror(path);
+        return NULL;
+    }
+
+    do {
+        if (*length + READ_BLOCK > capacity) {
+            capacity = capacity ? capacity * 2 : READ_BLOCK * 4;
+            uint8_t *grown = realloc(data, capacity);
+            if (!grown) {
+                fprintf(stderr, "%s: out of memory\n", path);
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+        }
+        n = fread(data + *length, 1, READ_BLOCK, fp);
+        *length += n;
+    } while (n > 0);
+
+    if (fp != stdin) fclose(fp);
+    return data;
+}
+
+static void report(FILE *fp, const hc_salvage_t *s, const char *path, size_t length, int quiet) {
+    size_t repaired = 0;
+    size_t damaged = 0;
+
+    for (size_t i = 0; i < s->parts_count; i++) repaired += s->parts[i].repaired != 0;
+    for (size_t i = 0; i < s->damage_count; i++) damaged += s->damage[i].binary_frames;
+
+    fprintf(fp, "%s: %zu bytes, %zu intact part%s in %u recovered voice%s, %zu repaired, %zu damaged span%s (%zu frames)\n",
+        path, length, s->parts_count, s->parts_count == 1 ? "" : "s", s->voices, s->voices == 1 ? "" : "s",
+        repaired, s->damage_count, s->damage_count == 1 ? "" : "s", damaged);
+    if (quiet) return;
+
+    // parts and damage in tape order
+    size_t d = 0;
+    for (size_t i = 0; i <= s->parts_count; i++) {
+        size_t before = i < s->parts_count ? s->parts[i].offset : length;
+
+        for (; d < s->damage_count && s->damage[d].start < before; d++) {
+            const hc_salvage_damage_t *dm = &s->damage[d];
+            fprintf(fp, "  %8zu-%-8zu damaged, %zu binary frame%s\n", dm->start, dm->end - 1, dm->binary_frames,
+                dm->binary_frames == 1 ? "" : "s");
+        }
+        if (i == s->parts_count) break;
+
+        const hc_salvage_part_t *p = &s->parts[i];
+        fprintf(fp, "  %8zu-%-8zu %s", p->offset, p->end - 1, PART_KINDS[p->kind]);
+        if (p->voice) fprintf(fp, " of recovered voice %u", p->voice);
+        fprintf(fp, ", %u words, checksum %06o", p->count, p->checksum);
+        if (p->repaired) fprintf(fp, ", %u blank frame%s inside words repaired", p->repaired, p->repaired == 1 ? "" : "s");
+        fputc('\n', fp);
+    }
+}
+
+static int punch(const hc_salvage_t *s, const char *path) {
+    FILE *fp = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    hc_salvage_punch(s, fp);
+    if (ferror(fp) | (fp != stdout && fclose(fp))) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *out_path = NULL;
+    const char *out_dir = NULL;
+    uint32_t min_gap = HC_SALVAGE_MIN_GAP;
+    int quiet = 0;
+    int status = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "qg:o:d:h")) != -1) {
+        switch (opt) {
+            case 'q': quiet = 1; break;
+            case 'g': min_gap = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'o': out_path = optarg; break;
+            case 'd': out_dir = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind == argc || (out_path && (out_dir || argc - optind > 1))) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // with the tape going to stdout, the report goes to stderr
+    FILE *report_fp = out_path && !strcmp(out_path, "-") ? stderr : stdout;
+
+    for (int i = optind; i < argc; i++) {
+        const char *path = argv[i];
+        hc_salvage_t s;
+        size_t length;
+        uint8_t *tape = read_file(path, &length);
+
+        if (!tape) {
+            status = 1;
+            continue;
+        }
+
+        hc_salvage_init(&s);
+        s.min_gap = min_gap;
+        if (hc_salvage_scan(&s, tape, length) < 0) {
+            fprintf(stderr, "%s: out of memory\n", path);
+            status = 1;
+        } else {
+            report(report_fp, &s, path, length, quiet);
+            if ((s.damage_count || s.parts_count != 2 * s.voices) && !status) status = 2;
+
+            if (out_path && punch(&s, out_path) < 0) status = 1;
+            if (out_dir) {
+                const char *base = strrchr(path, '/');
+                char *dest = malloc(strlen(out_dir) + strlen(path) + 16);
+                sprintf(dest, "%s/%s", out_dir, base ? base + 1 : strcmp(path, "-") ? path : "stdin.bin");
+                if (punch(&s, dest) < 0) status = 1;
+                free(dest);
+            }
+        }
+
+        hc_salvage_free(&s);
+        free(tape);
+    }
+
+    return status;
+}
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""
+Render a binary file as a 1-inch paper-tape hole pattern (Flexowriter / FIPS-26)
+in SVG, in either orientation, with the same geometry as dumpsvg.py (vertical)
+and dumpsvg-horiz.py (horizontal).
+
+Each distinct frame value is drawn once as a <symbol> (at most 256), and every
+frame is a single <use> of its symbol.  Runs of blank frames are a single
+rectangle filled with a feed-hole pattern.  The input is read and the SVG
+written in chunks, so memory use does not grow with the tape length.
+"""
+
+import sys
+import argparse
+
+CHUNK_SIZE = 64 * 1024  # 64 KiB per read
+
+# ─────────────────────────  Tape geometry (constants) ─────────────────────────
+TAPE_WIDTH = 1.0           # physical tape width (1 inch)
+HOLE_SPACING = 0.1         # spacing between hole rows, and between frames
+FEED_HOLE_POSITION = 3     # index of the feed hole row (0-based from the LSB edge)
+TOP_HOLE_CENTER = 0.392 - HOLE_SPACING * FEED_HOLE_POSITION
+CODE_HOLE_DIAM = 0.072     # diameter of data-bit holes
+FEED_HOLE_DIAM = 0.046     # diameter of feed hole
+MAX_HOLE_INDEX = 8         # highest row index (MSB)
+
+# per-orientation styling, as in the two original scripts
+VERTICAL = {"padding": 0.0, "hole_fill": "#071727", "stroke": None, "fold_len": None}
+HORIZONTAL = {"padding": 0.25, "hole_fill": "#012", "stroke": 0.01, "fold_len": 85}
+
+
+def num(value: float) -> str:
+    """Format a coordinate with at most 3 decimals and no trailing zeros."""
+    text = f"{value:.3f}".rstrip("0").rstrip(".")
+    return text if text not in ("", "-0") else "0"
+
+
+def iter_slice(path: str, start: int, end: int | None):
+    """Yield chunks of bytes start..end (inclusive) of *path*."""
+    with open(path, "rb") as f:
+        f.seek(start)
+        remaining = None if end is None else end - start + 1
+        while remaining is None or remaining > 0:
+            chunk = f.read(CHUNK_SIZE if remaining is None else min(CHUNK_SIZE, remaining))
+            if not chunk:
+                break
+            if remaining is not None:
+                remaining -= len(chunk)
+            yield chunk
+
+
+def hole_offsets(byte_val: int, horizontal: bool):
+    """Yield (across, along, radius) for each hole of a frame, relative to the frame's origin."""
+    for hole_index in range(9):          # 0…8, where 3 is the feed hole
+        if hole_index == FEED_HOLE_POSITION:
+            r = FEED_HOLE_DIAM / 2.0
+        else:
+            bit_num = hole_index if hole_index < FEED_HOLE_POSITION else hole_index - 1
+            if not (byte_val >> bit_num) & 1:
+                continue
+            r = CODE_HOLE_DIAM / 2.0
+        # horizontal tapes have the LSB at the top, vertical tapes mirror it to the right
+        row = hole_index if horizontal else MAX_HOLE_INDEX - hole_index
+        yield TOP_HOLE_CENTER + row * HOLE_SPACING, HOLE_SPACING / 2.0, r
+
+
+def main():
+    # ────────────────────────────  CLI arguments  ────────────────────────────────
+    parser = argparse.ArgumentParser(
+        description="Render a binary file as a paper-tape hole pattern in compact SVG."
+    )
+    parser.add_argument("input_file", help="Path to the binary file to read")
+    parser.add_argument(
+        "--horizontal", action="store_true",
+        help="Draw the tape left-to-right like dumpsvg-horiz.py (default: top-to-bottom like dumpsvg.py)"
+    )
+    parser.add_argument(
+        "--start-padding", type=float, default=None,
+        help="Padding at the start of the tape (in inches, default: 0 vertical, 0.25 horizontal)"
+    )
+    parser.add_argument(
+        "--end-padding", type=float, default=None,
+        help="Padding at the end of the tape (in inches, default: 0 vertical, 0.25 horizontal)"
+    )
+    parser.add_argument(
+        "--output-file", "-o", default="output.svg",
+        help="SVG file to write output into"
+    )
+    parser.add_argument(
+        "--start-byte", type=int, default=0,
+        help="Zero-based index of the first byte to draw (inclusive)"
+    )
+    parser.add_argument(
+        "--end-byte", type=int, default=None,
+        help="Zero-based index of the last byte to draw (inclusive). "
+             "If not set, all bytes from `start-byte` to EOF are drawn."
+    )
+    args = parser.parse_args()
+
+    style = HORIZONTAL if args.horizontal else VERTICAL
+    start_padding = style["padding"] if args.start_padding is None else args.start_padding
+    end_padding = style["padding"] if args.end_padding is None else args.end_padding
+    start_index = max(args.start_byte, 0)
+
+    # ───────────────  First pass: frame count and the frame values used  ───────────────
+    used = bytearray(256)
+    num_bytes = 0
+    try:
+        for chunk in iter_slice(args.input_file, start_index, args.end_byte):
+            num_bytes += len(chunk)
+            for value in set(chunk):
+                used[value] = 1
+    except OSError as exc:
+        sys.exit(f"Unable to read {args.input_file!r}: {exc}")
+
+    if num_bytes == 0:
+        print("No data in range; nothing to render.")
+        sys.exit(0)
+    end_index = start_index + num_bytes - 1
+
+    tape_length = start_padding + num_bytes * HOLE_SPACING + end_padding
+    if args.horizontal:
+        width, height = tape_length, TAPE_WIDTH
+    else:
+        width, height = TAPE_WIDTH, tape_length
+
+    def at(across: float, along: float):
+        """Map tape coordinates to SVG x, y for the chosen orientation."""
+        return (along, across) if args.horizontal else (across, along)
+
+    with open(args.output_file, "w", encoding="utf-8") as out:
+        out.write(
+            f'<svg xmlns="http://www.w3.org/2000/svg" '
+            f'width="{num(width)}in" height="{num(height)}in" '
+            f'viewBox="0 0 {num(width)} {num(height)}">\n'
+        )
+
+        # one symbol per frame value, in frame-local coordinates
+        out.write('<defs>\n')
+        for value in range(256):
+            if not used[value]:
+                continue
+            circles = "".join(
+                f'<circle cx="{num(x)}" cy="{num(y)}" r="{num(r)}"/>'
+                for x, y, r in (
+                    (*at(across, along), r) for across, along, r in hole_offsets(value, args.horizontal)
+                )
+            )
+            out.write(f'<symbol id="f{value}" overflow="visible">{circles}</symbol>\n')
+        pw, ph = at(TAPE_WIDTH, HOLE_SPACING)
+        px, py = at(0, start_padding)
+        feed = "".join(
+            f'<circle cx="{num(x)}" cy="{num(y)}" r="{num(r)}"/>'
+            for x, y, r in ((*at(across, along), r) for across, along, r in hole_offsets(0, args.horizontal))
+        )
+        out.write(
+            f'<pattern id="gap" patternUnits="userSpaceOnUse" width="{num(pw)}" height="{num(ph)}" '
+            f'patternTransform="translate({num(px)} {num(py)})" fill="{style["hole_fill"]}">{feed}</pattern>\n'
+        )
+        out.write('</defs>\n')
+
+        # tape background
+        stroke = style["stroke"]
+        stroke_attrs = f' stroke="black" stroke-width="{stroke}"' if stroke else ""
+        out.write(f'<rect x="0" y="0" width="{num(width)}" height="{num(height)}" fill="#abc"{stroke_attrs}/>\n')
+
+        # ─────────────────────────  Second pass: one <use> per frame  ─────────────────────────
+        # a <use> inherits from where it is drawn, not from <defs>, so the hole fill goes on the group around them
+        out.write(f'<g fill="{style["hole_fill"]}">\n')
+        axis = "x" if args.horizontal else "y"
+        fold_len = style["fold_len"]
+        frame = 0
+        gap_start = None
+
+        def gap_rect(first: int, last: int) -> str:
+            """A run of blank frames as one pattern-filled rectangle."""
+            if first == last:
+                return f'<use href="#f0" {axis}="{num(start_padding + first * HOLE_SPACING)}"/>\n'
+            gx, gy = at(0, start_padding + first * HOLE_SPACING)
+            gw, gh = at(TAPE_WIDTH, (last - first + 1) * HOLE_SPACING)
+            return f'<rect x="{num(gx)}" y="{num(gy)}" width="{num(gw)}" height="{num(gh)}" fill="url(#gap)"/>\n'
+
+        for chunk in iter_slice(args.input_file, start_index, end_index):
+            lines = []
+            for value in chunk:
+                along = start_padding + frame * HOLE_SPACING
+                if fold_len and frame % fold_len == 0:
+                    if gap_start is not None:
+                        lines.append(gap_rect(gap_start, frame - 1))
+                        gap_start = None
+                    fold_width = 0.02
+                    fx, fy = at(0, along - fold_width / 2)
+                    fw, fh = at(TAPE_WIDTH, fold_width)
+                    lines.append(
+                        f'<rect x="{num(fx)}" y="{num(fy)}" width="{num(fw)}" height="{num(fh)}" fill="#789"/>\n'
+                    )
+                if value == 0:
+                    if gap_start is None:
+                        gap_start = frame
+                else:
+                    if gap_start is not None:
+                        lines.append(gap_rect(gap_start, frame - 1))
+                        gap_start = None
+                    lines.append(f'<use href="#f{value}" {axis}="{num(along)}"/>\n')
+                frame += 1
+            out.writelines(lines)
+
+        if gap_start is not None:
+            out.write(gap_rect(gap_start, frame - 1))
+
+        out.write("</g>\n</svg>\n")
+
+    print(f"SVG paper tape written to {args.output_file}")
+    print(f"Bytes drawn: {start_index} through {end_index} (inclusive).")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,359 @@
+// Canvas paper tape viewer. Only the frames in the visible window are drawn, so scrolling and zooming cost the same
+// whatever the tape length. Load a tape with the file picker, or serve the repo root with `python3 -m http.server`
+// and open viewer/?tape=../output/boc-olson.bin
+const FEED_HOLE_POSITION = 3;   // hole row of the feed hole, as in verify/dumpsvg.py
+const HOLE_ROWS = 9;
+const MIN_ZOOM = 0.05;          // pixels per frame
+const MAX_ZOOM = 80;
+const PART_BAND_HEIGHT = 22;
+const WORD_LABEL_HEIGHT = 40;
+const END_OF_MEASURE = 0o600000;
+const TEMPO_MASK = 0o700000;
+
+const NOTE_NAMES = [ 'C', 'C#', 'D', 'D#', 'E', 'F', 'F#', 'G', 'G#', 'A', 'A#', 'B' ];
+const ARTICULATION_NAMES = { 0: 'normal', 1: 'quarter', 2: 'half', 4: 'staccato', 8: 'legato' };
+const VOICE_COLORS = [ '#e0a458', '#7fb069', '#6aa6d8', '#d07ab4' ];
+
+const COLORS = {
+  tape: '#abc',
+  hole: '#071727',
+  background: '#2a2834',
+  text: '#c9c1f4',
+  bad: '#ff5a5a',
+};
+
+// same field layout as hc_parse_note() in common/hcnote.h
+function parseNote(word) {
+  const articulation = ((word >> 14) & 0o14) | ((word & 0o060000) >> 13);
+  const triplet = (word & 0o100000) >> 15;
+  const pitch = (word >> 7) & 0o77;
+  const duration = word & 0o177;
+  const noteDuration = duration ? Math.floor(192 / (duration * (triplet ? 2 : 3))) : 0;
+  if (pitch > 1) {
+    const notePitch = pitch - 2;
+    return { articulation, triplet, pitch, noteDuration, name: `${NOTE_NAMES[notePitch % 12]}${Math.floor(notePitch / 12) + 1}` };
+  }
+  return { articulation, triplet, pitch, noteDuration, name: 'r' };
+}
+
+function addOnesComplement(a, b) {
+  const sum = a + b;
+  return ((sum & 0o777777) + (sum >>> 18)) & 0o777777;
+}
+
+// Index every word and part of the tape once, the way rpb reads it: frames without the 8th bit are blank, three
+// binary frames make a word, and each part is a word count, that many data words and a 1s complement checksum.
+function scanTape(bytes) {
+  const maxWords = Math.floor(bytes.length / 3) + 1;
+  const wordStart = new Uint32Array(maxWords);
+  const wordEnd = new Uint32Array(maxWords);
+  const wordValue = new Uint32Array(maxWords);
+  const wordPart = new Int32Array(maxWords);
+  const parts = [];
+
+  let words = 0;
+  let frames = 0;
+  let word = 0;
+  let start = 0;
+  let part = null;
+
+  for (let i = 0; i < bytes.length; i++) {
+    const c = bytes[i];
+    if (!(c & 0o200)) continue;
+    if (frames === 0) start = i;
+    word = (word << 6) | (c & 0o77);
+    if (++frames < 3) continue;
+
+    if (!part) {
+      const index = parts.length;
+      part = {
+        kind: index % 2 ? 'bars' : 'notes',
+        voice: Math.floor(index / 2) + 1,
+        firstWord: words,
+        startFrame: start,
+        endFrame: i,
+        count: word,
+        checksum: 0,
+        good: false,
+      };
+      parts.push(part);
+    } else if (words - part.firstWord <= part.count) {
+      part.checksum = addOnesComplement(part.checksum, word);
+    } else {
+      part.good = part.checksum === word;
+      part.endFrame = i;
+      part = null;
+    }
+    if (part) part.endFrame = i;
+
+    wordStart[words] = start;
+    wordEnd[words] = i;
+    wordValue[words] = word;
+    wordPart[words] = parts.length - 1;
+    words++;
+    frames = 0;
+    word = 0;
+  }
+
+  return { words, wordStart, wordEnd, wordValue, wordPart, parts };
+}
+
+// describe word w for its label, looking up bars in the notes part of the same voice
+function describeWord(index, w) {
+  const part = index.parts[index.wordPart[w]];
+  const word = index.wordValue[w];
+  const pos = w - part.firstWord;
+
+  if (pos === 0) return `V${part.voice} ${part.kind}: ${word}`;
+  if (pos > part.count) return part.good ? 'checksum ok' : 'BAD checksum';
+  if (word === END_OF_MEASURE) return '/';
+
+  if (part.kind === 'notes') {
+    if ((word & TEMPO_MASK) === TEMPO_MASK) return `tempo ${Math.floor(11436 / ((word & 0o77777) || 1))}`;
+    const note = parseNote(word);
+    return note.pitch > 1 ? `${note.name} t${note.noteDuration} ${ARTICULATION_NAMES[note.articulation] || '?'}` : `r t${note.noteDuration}`;
+  }
+
+  const notesPart = index.parts[index.wordPart[w] - 1];
+  if (!notesPart || word >= notesPart.count) return `bar ${pos}: ?`;
+  const names = [];
+  for (let n = notesPart.firstWord + 1 + word; n <= notesPart.firstWord + notesPart.count && index.wordValue[n] !== END_OF_MEASURE; n++) {
+    const note = parseNote(index.wordValue[n]);
+    names.push(`${note.name}t${note.noteDuration}`);
+    if (names.length >= 8) {
+      names.push('…');
+      break;
+    }
+  }
+  return `bar ${pos}: ${names.join(' ')}`;
+}
+
+// first word ending at or after frame
+function firstWordFrom(index, frame) {
+  let lo = 0;
+  let hi = index.words;
+  while (lo < hi) {
+    const mid = (lo + hi) >> 1;
+    if (index.wordEnd[mid] < frame) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+class TapeViewer {
+  bytes = new Uint8Array(0);
+  index = scanTape(this.bytes);
+  offset = 0;   // first visible frame (fractional)
+  zoom = 12;    // pixels per frame
+  pending = false;
+
+  constructor(canvas, slider, status) {
+    this.canvas = canvas;
+    this.ctx = canvas.getContext('2d');
+    this.slider = slider;
+    this.status = status;
+
+    new ResizeObserver(() => this.resize()).observe(canvas);
+    this.bindInput();
+  }
+
+  load(buffer, name) {
+    this.bytes = new Uint8Array(buffer);
+    this.index = scanTape(this.bytes);
+    this.name = name;
+    this.offset = 0;
+    this.slider.max = Math.max(0, this.bytes.length - 1);
+    this.update();
+  }
+
+  get visibleFrames() {
+    return this.canvas.clientWidth / this.zoom;
+  }
+
+  scrollTo(frame) {
+    const max = Math.max(0, this.bytes.length - this.visibleFrames * 0.5);
+    this.offset = Math.min(Math.max(0, frame), max);
+    this.update();
+  }
+
+  zoomAt(factor, x) {
+    const frameAtCursor = this.offset + x / this.zoom;
+    this.zoom = Math.min(MAX_ZOOM, Math.max(MIN_ZOOM, this.zoom * factor));
+    this.scrollTo(frameAtCursor - x / this.zoom);
+  }
+
+  bindInput() {
+    const canvas = this.canvas;
+
+    canvas.addEventListener('wheel', (event) => {
+      event.preventDefault();
+      if (event.ctrlKey || event.metaKey) {
+        this.zoomAt(Math.exp(-event.deltaY * 0.002), event.offsetX);
+      } else {
+        this.scrollTo(this.offset + (event.deltaX || event.deltaY) / this.zoom);
+      }
+    }, { passive: false });
+
+    let dragX = null;
+    canvas.addEventListener('pointerdown', (event) => {
+      dragX = event.clientX;
+      canvas.setPointerCapture(event.pointerId);
+      canvas.style.cursor = 'grabbing';
+    });
+    canvas.addEventListener('pointermove', (event) => {
+      if (dragX === null) return;
+      this.scrollTo(this.offset - (event.clientX - dragX) / this.zoom);
+      dragX = event.clientX;
+    });
+    canvas.addEventListener('pointerup', () => {
+      dragX = null;
+      canvas.style.cursor = 'grab';
+    });
+
+    canvas.addEventListener('keydown', (event) => {
+      const page = this.visibleFrames * 0.9;
+      switch (event.key) {
+        case 'ArrowLeft': this.scrollTo(this.offset - page / 10); break;
+        case 'ArrowRight': this.scrollTo(this.offset + page / 10); break;
+        case 'PageUp': this.scrollTo(this.offset - page); break;
+        case 'PageDown': this.scrollTo(this.offset + page); break;
+        case 'Home': this.scrollTo(0); break;
+        case 'End': this.scrollTo(this.bytes.length); break;
+        case '+': case '=': this.zoomAt(1.25, canvas.clientWidth / 2); break;
+        case '-': this.zoomAt(0.8, canvas.clientWidth / 2); break;
+        default: return;
+      }
+      event.preventDefault();
+    });
+
+    this.slider.addEventListener('input', () => this.scrollTo(Number(this.slider.value)));
+  }
+
+  resize() {
+    const ratio = window.devicePixelRatio || 1;
+    this.canvas.width = Math.round(this.canvas.clientWidth * ratio);
+    this.canvas.height = Math.round(this.canvas.clientHeight * ratio);
+    this.ctx.setTransform(ratio, 0, 0, ratio, 0, 0);
+    this.update();
+  }
+
+  // coalesce input events into one draw per animation frame
+  update() {
+    if (this.pending) return;
+    this.pending = true;
+    requestAnimationFrame(() => {
+      this.pending = false;
+      this.draw();
+    });
+  }
+
+  draw() {
+    const { ctx, zoom, bytes, index } = this;
+    const width = this.canvas.clientWidth;
+    const height = this.canvas.clientHeight;
+    const tapeTop = PART_BAND_HEIGHT + 8;
+    const tapeHeight = Math.max(40, Math.min(height - tapeTop - WORD_LABEL_HEIGHT - 8, 240));
+    const rowSpacing = tapeHeight / (HOLE_ROWS + 1);
+    const first = Math.max(0, Math.floor(this.offset));
+    const last = Math.min(bytes.length - 1, Math.ceil(this.offset + width / zoom));
+    const x = (frame) => (frame - this.offset) * zoom;
+
+    ctx.fillStyle = COLORS.background;
+    ctx.fillRect(0, 0, width, height);
+
+    if (bytes.length) {
+      ctx.fillStyle = COLORS.tape;
+      ctx.fillRect(Math.max(0, x(0)), tapeTop, Math.min(width, x(bytes.length)) - Math.max(0, x(0)), tapeHeight);
+    }
+
+    // holes: circles when there is room for them, single pixel columns when zoomed far out, each column the union
+    // of the frames under it so no hole drops out; columns start on multiples of columnStep so they hold still on pan
+    ctx.fillStyle = COLORS.hole;
+    const radius = Math.min(zoom, rowSpacing) * 0.36;
+    const columnStep = zoom < 1 ? Math.ceil(1 / zoom) : 1;
+    for (let frame = first - (first % columnStep); frame <= last; frame += columnStep) {
+      let c = 0;
+      for (let f = frame; f < frame + columnStep && f < bytes.length; f++) c |= bytes[f];
+      const cx = x(frame + 0.5);
+      for (let row = 0; row < HOLE_ROWS; row++) {
+        const feed = row === FEED_HOLE_POSITION;
+        const bit = row < FEED_HOLE_POSITION ? row : row - 1;
+        if (!feed && !((c >> bit) & 1)) continue;
+        const cy = tapeTop + (row + 1) * rowSpacing;
+        const r = feed ? radius * 0.64 : radius;
+        if (zoom >= 4) {
+          ctx.beginPath();
+          ctx.arc(cx, cy, r, 0, 2 * Math.PI);
+          ctx.fill();
+        } else {
+          ctx.fillRect(cx, cy - r, Math.max(1, zoom * columnStep * 0.6), 2 * r);
+        }
+      }
+    }
+
+    // part bands: one per notes/bars part, colored by voice
+    ctx.font = '12px sans-serif';
+    ctx.textBaseline = 'middle';
+    for (const part of index.parts) {
+      if (part.endFrame < first || part.startFrame > last) continue;
+      const left = x(part.startFrame);
+      const right = x(part.endFrame + 1);
+      ctx.fillStyle = VOICE_COLORS[(part.voice - 1) % VOICE_COLORS.length];
+      ctx.globalAlpha = part.kind === 'notes' ? 0.9 : 0.55;
+      ctx.fillRect(left, 4, right - left, PART_BAND_HEIGHT);
+      ctx.globalAlpha = 1;
+      ctx.fillStyle = part.good ? COLORS.background : COLORS.bad;
+      const label = `voice ${part.voice} ${part.kind} · ${part.count} words${part.good ? '' : ' · BAD checksum'}`;
+      ctx.fillText(label, Math.max(left, 0) + 4, 4 + PART_BAND_HEIGHT / 2, Math.max(0, right - Math.max(left, 0) - 8));
+    }
+
+    // word brackets and labels when a word is wide enough to read
+    const wordsTop = tapeTop + tapeHeight + 4;
+    if (zoom >= 4) {
+      ctx.strokeStyle = COLORS.text;
+      ctx.fillStyle = COLORS.text;
+      ctx.textBaseline = 'top';
+      for (let w = firstWordFrom(index, first); w < index.words && index.wordStart[w] <= last; w++) {
+        const left = x(index.wordStart[w]) + 1;
+        const right = x(index.wordEnd[w] + 1) - 1;
+        ctx.beginPath();
+        ctx.moveTo(left, wordsTop);
+        ctx.lineTo(left, wordsTop + 4);
+        ctx.lineTo(right, wordsTop + 4);
+        ctx.lineTo(right, wordsTop);
+        ctx.stroke();
+        if (right - left >= 40) {
+          ctx.fillText(index.wordValue[w].toString(8).padStart(6, '0'), left, wordsTop + 8, right - left);
+          ctx.fillText(describeWord(index, w), left, wordsTop + 24, right - left);
+        }
+      }
+    }
+
+    this.slider.value = String(Math.floor(this.offset));
+    this.status.textContent = bytes.length
+      ? `${this.name}: frames ${first}–${last} of ${bytes.length} · ${index.parts.length / 2 | 0} voices · ${zoom.toFixed(2)} px/frame`
+      : 'no tape loaded';
+  }
+}
+
+(function main() {
+  const viewer = new TapeViewer(
+    document.getElementById('tape'),
+    document.getElementById('position'),
+    document.getElementById('status'),
+  );
+
+  document.getElementById('file').addEventListener('change', async (event) => {
+    const file = event.target.files[0];
+    if (file) viewer.load(await file.arrayBuffer(), file.name);
+    viewer.canvas.focus();
+  });
+  document.getElementById('zoom-in').addEventListener('click', () => viewer.zoomAt(1.25, viewer.canvas.clientWidth / 2));
+  document.getElementById('zoom-out').addEventListener('click', () => viewer.zoomAt(0.8, viewer.canvas.clientWidth / 2));
+
+  const tape = new URLSearchParams(location.search).get('tape');
+  if (tape) {
+    fetch(tape)
+      .then(res => res.arrayBuffer())
+      .then(buffer => viewer.load(buffer, tape.split('/').pop()));
+  }
+})();